@@ -0,0 +1,155 @@
+#include "Exporter.h"
+
+#include <gst/app/gstappsrc.h>
+
+#include "defines.h"
+#include "Log.h"
+#include "FrameBuffer.h"
+#include "SystemToolkit.h"
+
+Exporter::Exporter(const std::string &filename, uint width, uint height, float fps) :
+    filename_(filename), width_(width), height_(height), fps_(fps), pipeline_(nullptr), src_(nullptr),
+    frames_(0), failed_(false), start_time_(0), end_time_(0)
+{
+    // encoder and container from file extension
+    std::string extension = SystemToolkit::extension_filename(filename_);
+    std::string encoder;
+    if (extension == "mp4")
+        encoder = "x264enc pass=qual quantizer=20 ! video/x-h264, profile=high ! h264parse ! mp4mux";
+    else if (extension == "webm")
+        encoder = "vp8enc deadline=1 ! webmmux";
+    else
+        encoder = "x264enc pass=qual quantizer=20 ! h264parse ! matroskamux";
+
+    // build string describing pipeline (frames are read bottom-up)
+    std::string description = "appsrc name=src ! videoflip method=vertical-flip ! videoconvert ! ";
+    description += encoder + " ! filesink name=sink";
+
+    // parse pipeline descriptor
+    GError *error = NULL;
+    pipeline_ = gst_parse_launch (description.c_str(), &error);
+    if (error != NULL) {
+        Log::Warning("Exporter Could not construct pipeline %s:\n%s", description.c_str(), error->message);
+        g_clear_error (&error);
+        failed_ = true;
+        return;
+    }
+
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline_), "sink");
+    if (sink) {
+        g_object_set (sink, "location", filename_.c_str(), NULL);
+        gst_object_unref (sink);
+    }
+
+    // setup appsrc: raw RGBA frames at fixed frame rate, time stamped by us
+    src_ = gst_bin_get_by_name (GST_BIN (pipeline_), "src");
+    if (src_ == nullptr) {
+        failed_ = true;
+        return;
+    }
+    GstCaps *caps = gst_caps_new_simple ("video/x-raw",
+                                         "format", G_TYPE_STRING, "RGBA",
+                                         "width",  G_TYPE_INT, width_,
+                                         "height", G_TYPE_INT, height_,
+                                         "framerate", GST_TYPE_FRACTION, static_cast<int>(fps_ * 1000.f), 1000,
+                                         NULL);
+    // block when encoder is behind, instead of queuing frames in memory
+    g_object_set (src_, "caps", caps, "format", GST_FORMAT_TIME, "is-live", FALSE,
+                  "block", TRUE, "max-bytes", (guint64) 4 * width_ * height_ * 4, NULL);
+    gst_caps_unref (caps);
+
+    GstStateChangeReturn ret = gst_element_set_state (pipeline_, GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        Log::Warning("Exporter Could not start pipeline for %s", filename_.c_str());
+        failed_ = true;
+        return;
+    }
+
+    pixels_.resize( 4 * width_ * height_ );
+    Log::Info("Exporting %d x %d at %.2f fps to %s", width_, height_, fps_, filename_.c_str());
+}
+
+Exporter::~Exporter()
+{
+    close();
+    if (src_)
+        gst_object_unref (src_);
+}
+
+bool Exporter::addFrame(FrameBuffer *frame)
+{
+    if (failed_ || src_ == nullptr || frame == nullptr)
+        return false;
+
+    if (frame->width() != width_ || frame->height() != height_) {
+        Log::Warning("Exporter Frame size changed; cannot export to %s", filename_.c_str());
+        failed_ = true;
+        return false;
+    }
+
+    if (frames_ == 0)
+        start_time_ = g_get_monotonic_time();
+
+    if ( !frame->readPixels(pixels_.data()) )
+        return false;
+
+    // time stamp of frame n is exactly n / fps
+    GstBuffer *buffer = gst_buffer_new_allocate (NULL, pixels_.size(), NULL);
+    gst_buffer_fill (buffer, 0, pixels_.data(), pixels_.size());
+    GST_BUFFER_PTS (buffer) = gst_util_uint64_scale (frames_, GST_SECOND * 1000, static_cast<guint64>(fps_ * 1000.f));
+    GST_BUFFER_DURATION (buffer) = gst_util_uint64_scale (frames_ + 1, GST_SECOND * 1000, static_cast<guint64>(fps_ * 1000.f))
+            - GST_BUFFER_PTS (buffer);
+
+    // push (takes ownership of buffer)
+    if ( gst_app_src_push_buffer (GST_APP_SRC (src_), buffer) != GST_FLOW_OK ) {
+        Log::Warning("Exporter Failed to encode frame %d of %s", frames_, filename_.c_str());
+        failed_ = true;
+        return false;
+    }
+
+    frames_++;
+    end_time_ = g_get_monotonic_time();
+
+    return true;
+}
+
+void Exporter::close()
+{
+    if (pipeline_ == nullptr)
+        return;
+
+    if (src_ && !failed_) {
+        // end of stream, and wait for the file to be finished
+        gst_app_src_end_of_stream (GST_APP_SRC (src_));
+        GstBus *bus = gst_element_get_bus (pipeline_);
+        GstMessage *msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                                      (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (msg) {
+            if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+                GError *error = NULL;
+                gst_message_parse_error (msg, &error, NULL);
+                Log::Warning("Exporter Error writing %s:\n%s", filename_.c_str(), error->message);
+                g_clear_error (&error);
+                failed_ = true;
+            }
+            gst_message_unref (msg);
+        }
+        gst_object_unref (bus);
+        end_time_ = g_get_monotonic_time();
+    }
+
+    gst_element_set_state (pipeline_, GST_STATE_NULL);
+    gst_object_unref (pipeline_);
+    pipeline_ = nullptr;
+
+    if (!failed_)
+        Log::Notify("Exported %d frames to %s (%.1f fps)", frames_, filename_.c_str(), throughput());
+}
+
+double Exporter::throughput() const
+{
+    if (frames_ < 1 || end_time_ <= start_time_)
+        return 0.0;
+
+    return static_cast<double>(frames_) * 1000000.0 / static_cast<double>(end_time_ - start_time_);
+}
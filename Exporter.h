@@ -0,0 +1,51 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <gst/gst.h>
+
+class FrameBuffer;
+
+/**
+ * @brief The Exporter class encodes frame buffers into a video file
+ *
+ * Frames are read back from a FrameBuffer and pushed to an encoding
+ * pipeline with time stamps of a fixed frame rate: the video is frame
+ * accurate, whatever the time it takes to render and encode each frame.
+ * The encoder and container follow the extension of the file name
+ * (.mp4 for H264, .webm for VP8, Matroska otherwise).
+ */
+class Exporter
+{
+public:
+    Exporter(const std::string &filename, uint width, uint height, float fps);
+    ~Exporter();
+
+    // encode the content of the frame buffer as the next frame
+    bool addFrame(FrameBuffer *frame);
+    // finish the file (blocking until encoded)
+    void close();
+
+    inline bool failed() const { return failed_; }
+    inline int frames() const { return frames_; }
+    inline std::string filename() const { return filename_; }
+
+    // frames encoded per second of real time since first frame
+    double throughput() const;
+
+private:
+    std::string filename_;
+    uint width_, height_;
+    float fps_;
+    GstElement *pipeline_;
+    GstElement *src_;
+    std::vector<uint8_t> pixels_;
+    int frames_;
+    bool failed_;
+    gint64 start_time_;
+    gint64 end_time_;
+};
+
+#endif // EXPORTER_H
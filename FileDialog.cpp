@@ -1,5 +1,6 @@
 #include "FileDialog.h"
 #include "ImGuiToolkit.h"
+#include "GlState.h"
 
 #include <fstream>
 #include <iostream>
@@ -1109,7 +1110,7 @@ inline void ImageInfosPane(std::string vFilter, bool *vCantContinue) // if vCant
     // generate texture (once) & clear
     if (tex == 0) {
         glGenTextures(1, &tex);
-        glBindTexture( GL_TEXTURE_2D, tex);
+        GlState::bindTexture(0, tex);
         unsigned char clearColor[4] = {0};
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, clearColor);
     }
@@ -1121,7 +1122,7 @@ inline void ImageInfosPane(std::string vFilter, bool *vCantContinue) // if vCant
         filepathcurrent = FileDialog::Instance()->GetFilepathName();
 
         // prepare texture
-        glBindTexture( GL_TEXTURE_2D, tex);
+        GlState::bindTexture(0, tex);
 
         // load image
         int w, h, n;
@@ -2,10 +2,21 @@
 #include "ImageShader.h"
 #include "Resource.h"
 #include "Log.h"
+#include "GlState.h"
+#include "defines.h"
 
 
 #include <glad/glad.h>
 
+#include <map>
+#include <tuple>
+#include <chrono>
+
+// maximum number of unused targets kept per size & format
+#define POOL_MAX_FREE 2
+// delay before deleting an unused target (seconds)
+#define POOL_FREE_DELAY 10
+
 const char* FrameBuffer::aspect_ratio_name[4] = { "4:3", "3:2", "16:10", "16:9" };
 glm::vec2 FrameBuffer::aspect_ratio_size[4] = { glm::vec2(4.f,3.f), glm::vec2(3.f,2.f), glm::vec2(16.f,10.f), glm::vec2(16.f,9.f) };
 const char* FrameBuffer::resolution_name[4] = { "720p", "1080p", "1440", "4K" };
@@ -20,13 +31,109 @@ glm::vec3 FrameBuffer::getResolutionFromParameters(int ar, int h)
     return res;
 }
 
-FrameBuffer::FrameBuffer(glm::vec3 resolution, bool useAlpha, bool useDepthBuffer): textureid_(0), framebufferid_(0), usealpha_(useAlpha), usedepth_(useDepthBuffer)
+// render targets of the pool, by size and format
+// With multisampling, the framebuffer draws into multisample color and depth
+// renderbuffers, and the resolve framebuffer holds the texture.
+struct RenderTarget {
+    uint framebuffer;
+    uint texture;
+    uint depthbuffer;
+    uint colorbuffer;
+    uint resolve;
+    std::chrono::steady_clock::time_point released;
+};
+// width, height, alpha, depth, mipmap, samples
+typedef std::tuple<uint, uint, bool, bool, bool, uint> RenderTargetKey;
+struct RenderTargetBucket {
+    uint used;
+    std::vector<RenderTarget> free;
+    RenderTargetBucket() : used(0) {}
+};
+static std::map<RenderTargetKey, RenderTargetBucket> pool_;
+
+static size_t targetBytes(const RenderTargetKey &key)
+{
+    size_t pixels = (size_t) std::get<0>(key) * (size_t) std::get<1>(key);
+    size_t color = pixels * ( std::get<2>(key) ? 4 : 3 );
+    size_t depth = std::get<3>(key) ? pixels * 4 : 0;
+    // mipmap levels add a third of the texture
+    size_t texture = std::get<4>(key) ? color + color / 3 : color;
+    uint samples = std::get<5>(key);
+    if (samples > 0)
+        return texture + (color + depth) * samples;
+    return texture + depth;
+}
+
+static void deleteTarget(const RenderTarget &target)
+{
+    GlState::deleteFramebuffer(target.framebuffer);
+    GlState::deleteTexture(target.texture);
+    if (target.depthbuffer)
+        glDeleteRenderbuffers(1, &target.depthbuffer);
+    if (target.colorbuffer)
+        glDeleteRenderbuffers(1, &target.colorbuffer);
+    if (target.resolve)
+        GlState::deleteFramebuffer(target.resolve);
+}
+
+std::vector<FrameBuffer::PoolBucket> FrameBuffer::poolStatistics()
+{
+    std::vector<PoolBucket> stats;
+    for (auto b = pool_.begin(); b != pool_.end(); b++) {
+        PoolBucket bucket;
+        std::tie(bucket.width, bucket.height, bucket.alpha, bucket.depth, bucket.mipmap, bucket.samples) = b->first;
+        bucket.used = b->second.used;
+        bucket.free = b->second.free.size();
+        bucket.bytes = targetBytes(b->first) * (bucket.used + bucket.free);
+        stats.push_back(bucket);
+    }
+    return stats;
+}
+
+size_t FrameBuffer::poolBytes()
+{
+    size_t bytes = 0;
+    for (auto b = pool_.begin(); b != pool_.end(); b++)
+        bytes += targetBytes(b->first) * (b->second.used + b->second.free.size());
+    return bytes;
+}
+
+void FrameBuffer::updatePool()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (auto b = pool_.begin(); b != pool_.end(); ) {
+        // delete targets released long ago (oldest first)
+        std::vector<RenderTarget> &free = b->second.free;
+        while ( !free.empty() && now - free.front().released > std::chrono::seconds(POOL_FREE_DELAY) ) {
+            deleteTarget(free.front());
+            free.erase(free.begin());
+        }
+        // remove empty buckets
+        if ( free.empty() && b->second.used == 0 )
+            b = pool_.erase(b);
+        else
+            b++;
+    }
+}
+
+void FrameBuffer::trimPool()
+{
+    for (auto b = pool_.begin(); b != pool_.end(); b++) {
+        for (auto t = b->second.free.begin(); t != b->second.free.end(); t++)
+            deleteTarget(*t);
+        b->second.free.clear();
+    }
+}
+
+FrameBuffer::FrameBuffer(glm::vec3 resolution, bool useAlpha, bool useDepthBuffer): textureid_(0), framebufferid_(0), depthbufferid_(0),
+    colorbufferid_(0), resolveid_(0), usealpha_(useAlpha), usedepth_(useDepthBuffer), usemipmap_(false), samples_(0), evicted_(false)
 {
     attrib_.viewport = glm::ivec2(resolution);
     attrib_.clear_color = glm::vec4(0.f, 0.f, 0.f, usealpha_ ? 0.f : 1.f);
 }
 
-FrameBuffer::FrameBuffer(uint width, uint height, bool useAlpha, bool useDepthBuffer): textureid_(0), framebufferid_(0), usealpha_(useAlpha), usedepth_(useDepthBuffer)
+FrameBuffer::FrameBuffer(uint width, uint height, bool useAlpha, bool useDepthBuffer): textureid_(0), framebufferid_(0), depthbufferid_(0),
+    colorbufferid_(0), resolveid_(0), usealpha_(useAlpha), usedepth_(useDepthBuffer), usemipmap_(false), samples_(0), evicted_(false)
 {
     attrib_.viewport = glm::ivec2(width, height);
     attrib_.clear_color = glm::vec4(0.f, 0.f, 0.f, usealpha_ ? 0.f : 1.f);
@@ -34,52 +141,173 @@ FrameBuffer::FrameBuffer(uint width, uint height, bool useAlpha, bool useDepthBu
 
 void FrameBuffer::init()
 {
+    evicted_ = false;
+
+    RenderTargetBucket &bucket = pool_[ RenderTargetKey(attrib_.viewport.x, attrib_.viewport.y, usealpha_, usedepth_, usemipmap_, samples_) ];
+    bucket.used++;
+
+    // reuse a target of the pool (most recently released)
+    if ( !bucket.free.empty() ) {
+        RenderTarget target = bucket.free.back();
+        bucket.free.pop_back();
+        framebufferid_ = target.framebuffer;
+        textureid_ = target.texture;
+        depthbufferid_ = target.depthbuffer;
+        colorbufferid_ = target.colorbuffer;
+        resolveid_ = target.resolve;
+        return;
+    }
+
     // create a renderbuffer object to store depth info
-    GLuint rboId;
     if (usedepth_){
-        glGenRenderbuffers(1, &rboId);
-        glBindRenderbuffer(GL_RENDERBUFFER, rboId);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, attrib_.viewport.x, attrib_.viewport.y);
+        glGenRenderbuffers(1, &depthbufferid_);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthbufferid_);
+        if (samples_ > 0)
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples_, GL_DEPTH_COMPONENT, attrib_.viewport.x, attrib_.viewport.y);
+        else
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, attrib_.viewport.x, attrib_.viewport.y);
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
     }
 
-    // create a framebuffer object
-    glGenFramebuffers(1, &framebufferid_);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebufferid_);
+    // create a multisample framebuffer object to draw into
+    if (samples_ > 0) {
+        glGenRenderbuffers(1, &colorbufferid_);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorbufferid_);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples_, usealpha_ ? GL_RGBA8 : GL_RGB8,
+                                         attrib_.viewport.x, attrib_.viewport.y);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &framebufferid_);
+        GlState::bindFramebuffer(framebufferid_);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  GL_RENDERBUFFER, colorbufferid_);
+        if (usedepth_)
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                      GL_RENDERBUFFER, depthbufferid_);
+        checkFramebufferStatus();
+    }
+
+    // create a framebuffer object (to resolve into if multisample)
+    uint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    GlState::bindFramebuffer(fbo);
+    if (samples_ > 0)
+        resolveid_ = fbo;
+    else
+        framebufferid_ = fbo;
 
     // generate texture
     glGenTextures(1, &textureid_);
-    glBindTexture(GL_TEXTURE_2D, textureid_);
+    GlState::bindTexture(0, textureid_);
     if (usealpha_)
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, attrib_.viewport.x, attrib_.viewport.y,
                      0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     else
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, attrib_.viewport.x, attrib_.viewport.y,
                      0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    if (usemipmap_) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
 
     // attach the texture to FBO color attachment point
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                            GL_TEXTURE_2D, textureid_, 0);
 
     // attach the renderbuffer to depth attachment point
-    if (usedepth_){
+    if (usedepth_ && samples_ == 0){
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-                              GL_RENDERBUFFER, rboId);
+                              GL_RENDERBUFFER, depthbufferid_);
     }
     checkFramebufferStatus();
 }
 
 FrameBuffer::~FrameBuffer()
 {
-    if (framebufferid_)
-        glDeleteFramebuffers(1, &framebufferid_);
+    releaseTarget();
+}
+
+void FrameBuffer::releaseTarget()
+{
+    if (!framebufferid_)
+        return;
+
+    RenderTarget target = { framebufferid_, textureid_, depthbufferid_, colorbufferid_, resolveid_, std::chrono::steady_clock::now() };
+    RenderTargetBucket &bucket = pool_[ RenderTargetKey(attrib_.viewport.x, attrib_.viewport.y, usealpha_, usedepth_, usemipmap_, samples_) ];
+    bucket.used--;
+
+    // give the target back to the pool, or delete it if enough are kept
+    if ( bucket.free.size() < POOL_MAX_FREE )
+        bucket.free.push_back(target);
+    else
+        deleteTarget(target);
+
+    framebufferid_ = 0;
+    textureid_ = 0;
+    depthbufferid_ = 0;
+    colorbufferid_ = 0;
+    resolveid_ = 0;
+}
+
+void FrameBuffer::setMipmap(bool on)
+{
+    if (on == usemipmap_)
+        return;
+
+    // target is created again at next bind
+    releaseTarget();
+    usemipmap_ = on;
+}
+
+void FrameBuffer::setSamples(uint samples)
+{
+    // limit multisampling to the capacity of the GPU (queried once)
+    static GLint max_samples = -1;
+    if (samples > 0) {
+        if (max_samples < 0)
+            glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+        samples = MINI(samples, (uint) MAXI(max_samples, 0));
+    }
+    if (samples < 2)
+        samples = 0;
+    if (samples == samples_)
+        return;
+
+    // target is created again at next bind
+    releaseTarget();
+    samples_ = samples;
+}
+
+size_t FrameBuffer::bytes() const
+{
+    if (framebufferid_ == 0)
+        return 0;
+
+    return targetBytes( RenderTargetKey(attrib_.viewport.x, attrib_.viewport.y, usealpha_, usedepth_, usemipmap_, samples_) );
 }
 
+void FrameBuffer::evict()
+{
+    evicted_ = true;
+    if (framebufferid_ == 0)
+        return;
+
+    // delete the target (not given back to the pool)
+    RenderTarget target = { framebufferid_, textureid_, depthbufferid_, colorbufferid_, resolveid_, std::chrono::steady_clock::now() };
+    pool_[ RenderTargetKey(attrib_.viewport.x, attrib_.viewport.y, usealpha_, usedepth_, usemipmap_, samples_) ].used--;
+    deleteTarget(target);
+
+    framebufferid_ = 0;
+    textureid_ = 0;
+    depthbufferid_ = 0;
+    colorbufferid_ = 0;
+    resolveid_ = 0;
+}
 
 uint FrameBuffer::texture() const
 {
@@ -105,7 +333,7 @@ void FrameBuffer::bind()
     if (!framebufferid_)
         init();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, framebufferid_);
+    GlState::bindFramebuffer(framebufferid_);
 }
 
 void FrameBuffer::begin()
@@ -121,12 +349,42 @@ void FrameBuffer::end()
 {
     Rendering::manager().PopAttrib();
 
+    resolve();
+
     FrameBuffer::release();
 }
 
+void FrameBuffer::resolve()
+{
+    if (!framebufferid_)
+        return;
+
+    // copy multisample target into the texture
+    if (resolveid_) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferid_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveid_);
+        glBlitFramebuffer(0, 0, attrib_.viewport.x, attrib_.viewport.y,
+                          0, 0, attrib_.viewport.x, attrib_.viewport.y,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        GlState::invalidateFramebuffer();
+        GlState::bindFramebuffer(0);
+    }
+
+    // content changed: update the mipmap levels
+    if (usemipmap_) {
+        GlState::bindTexture(0, textureid_);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+uint FrameBuffer::resolvedFramebuffer() const
+{
+    return resolveid_ ? resolveid_ : framebufferid_;
+}
+
 void FrameBuffer::release()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GlState::bindFramebuffer(0);
 }
 
 bool FrameBuffer::blit(FrameBuffer *other)
@@ -137,13 +395,33 @@ bool FrameBuffer::blit(FrameBuffer *other)
     if (attrib_.viewport.x != other->width() || attrib_.viewport.y != other->height())
         return false;
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, other->framebufferid_);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferid_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, other->resolvedFramebuffer());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolvedFramebuffer());
     // blit to the frame buffer object
     glBlitFramebuffer(0, attrib_.viewport.y, attrib_.viewport.x, 0, 0, 0,
                     other->width(), other->height(),
                     GL_COLOR_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    GlState::invalidateFramebuffer();
+    GlState::bindFramebuffer(0);
+
+    if (other->usemipmap_) {
+        GlState::bindTexture(0, other->textureid_);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    return true;
+}
+
+bool FrameBuffer::readPixels(uint8_t *pixels)
+{
+    if (!framebufferid_)
+        return false;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolvedFramebuffer());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, attrib_.viewport.x, attrib_.viewport.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    GlState::invalidateFramebuffer();
+    GlState::bindFramebuffer(0);
 
     return true;
 }
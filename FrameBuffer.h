@@ -1,6 +1,8 @@
 #ifndef FRAMEBUFFER_H
 #define FRAMEBUFFER_H
 
+#include <vector>
+
 #include "Scene.h"
 #include "RenderingManager.h"
 
@@ -30,6 +32,11 @@ public:
     // blit copy to another, returns true on success
     bool blit(FrameBuffer *other);
 
+    // read back RGBA pixels (bottom-up rows) into width x height x 4 bytes,
+    // returns true on success. If a pixel pack buffer is bound, pixels is
+    // the offset in the buffer and the read is asynchronous.
+    bool readPixels(uint8_t *pixels = nullptr);
+
     // clear color
     inline void setClearColor(glm::vec4 color) { attrib_.clear_color = color; }
     inline glm::vec4 clearColor() const { return attrib_.clear_color; }
@@ -43,14 +50,59 @@ public:
     // texture index for draw
     uint texture() const;
 
+    // GPU memory used by the render target (0 if none)
+    size_t bytes() const;
+
+    // Options of the render target (changing an option recreates it):
+    // mipmap: the texture has a chain of mipmap levels, regenerated at
+    // end of each draw, for drawing at reduced size without aliasing
+    void setMipmap(bool on);
+    inline bool mipmap() const { return usemipmap_; }
+    // samples: draw into a multisample target (0 for none), resolved
+    // into the texture at end of each draw
+    void setSamples(uint samples);
+    inline uint samples() const { return samples_; }
+
+    // delete the render target to free GPU memory; until restored,
+    // the texture is black and the frame buffer shall not be drawn into
+    void evict();
+    inline void restore() { evicted_ = false; }
+    inline bool evicted() const { return evicted_; }
+
+    // Pool of render targets (framebuffer object and its attachments)
+    // The target of a FrameBuffer is acquired at init and released to the
+    // pool when deleted, to be reused by a FrameBuffer of the same size
+    // and format. Unused targets are deleted after a delay.
+    struct PoolBucket {
+        uint width, height;
+        bool alpha, depth, mipmap;
+        uint samples;
+        uint used, free;
+        size_t bytes;
+    };
+    static std::vector<PoolBucket> poolStatistics();
+    static size_t poolBytes();
+    // delete targets unused for a while; call once per frame
+    static void updatePool();
+    // delete all unused targets
+    static void trimPool();
+
 private:
     void init();
+    void releaseTarget();
+    void resolve();
+    uint resolvedFramebuffer() const;
     void checkFramebufferStatus();
 
     RenderingAttrib attrib_;
     uint textureid_;
     uint framebufferid_;
-    bool usealpha_, usedepth_;
+    uint depthbufferid_;
+    uint colorbufferid_;
+    uint resolveid_;
+    bool usealpha_, usedepth_, usemipmap_;
+    uint samples_;
+    bool evicted_;
 };
 
 
@@ -0,0 +1,196 @@
+#include "FrameGrabber.h"
+
+#include <glad/glad.h>
+#include <gst/app/gstappsrc.h>
+
+#include "defines.h"
+#include "Log.h"
+#include "FrameBuffer.h"
+
+FrameGrabber::FrameGrabber(uint width, uint height) :
+    width_(width), height_(height), max_queued_(1), pipeline_(nullptr), src_(nullptr),
+    start_time_(GST_CLOCK_TIME_NONE), last_time_(0), frame_index_(0), frames_(0), dropped_(0),
+    latency_(0.f), failed_(false), pbo_next_(0), pbo_pending_(0)
+{
+    frame_size_ = 4 * static_cast<size_t>(width_) * static_cast<size_t>(height_);
+
+    for (int i = 0; i < PBO_COUNT; ++i) {
+        pbo_[i] = 0;
+        fence_[i] = nullptr;
+        pts_[i] = 0;
+        index_[i] = 0;
+        render_time_[i] = 0;
+    }
+}
+
+FrameGrabber::~FrameGrabber()
+{
+    FrameGrabber::stop();
+
+    for (int i = 0; i < PBO_COUNT; ++i) {
+        if (fence_[i])
+            glDeleteSync( (GLsync) fence_[i] );
+    }
+    if (pbo_[0])
+        glDeleteBuffers(PBO_COUNT, pbo_);
+}
+
+bool FrameGrabber::init(const std::string &description, bool live, size_t max_queued)
+{
+    max_queued_ = max_queued;
+
+    // parse pipeline descriptor (frames are read bottom-up)
+    std::string launch = "appsrc name=src ! " + description;
+    GError *error = NULL;
+    pipeline_ = gst_parse_launch (launch.c_str(), &error);
+    if (error != NULL) {
+        Log::Warning("FrameGrabber Could not construct pipeline %s:\n%s", launch.c_str(), error->message);
+        g_clear_error (&error);
+        if (pipeline_)
+            gst_object_unref (pipeline_);
+        pipeline_ = nullptr;
+        failed_ = true;
+        return false;
+    }
+
+    // setup appsrc: raw RGBA frames with variable frame rate, never blocking
+    src_ = gst_bin_get_by_name (GST_BIN (pipeline_), "src");
+    if (src_ == nullptr) {
+        failed_ = true;
+        return false;
+    }
+    GstCaps *caps = gst_caps_new_simple ("video/x-raw",
+                                         "format", G_TYPE_STRING, "RGBA",
+                                         "width",  G_TYPE_INT, width_,
+                                         "height", G_TYPE_INT, height_,
+                                         "framerate", GST_TYPE_FRACTION, 0, 1,
+                                         NULL);
+    g_object_set (src_, "caps", caps, "format", GST_FORMAT_TIME, "is-live", live ? TRUE : FALSE,
+                  "block", FALSE, "max-bytes", (guint64) (max_queued_ * frame_size_), NULL);
+    gst_caps_unref (caps);
+
+    GstStateChangeReturn ret = gst_element_set_state (pipeline_, GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        Log::Warning("FrameGrabber Could not start pipeline %s", launch.c_str());
+        failed_ = true;
+        return false;
+    }
+
+    // ring of pixel pack buffers
+    glGenBuffers(PBO_COUNT, pbo_);
+    for (int i = 0; i < PBO_COUNT; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size_, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return true;
+}
+
+void FrameGrabber::addFrame(FrameBuffer *frame)
+{
+    if (failed_ || pipeline_ == nullptr || frame == nullptr)
+        return;
+
+    // give frames read during previous frames (if ready)
+    pushFrames(false);
+
+    GstClockTime now = gst_util_get_timestamp ();
+    if (start_time_ == GST_CLOCK_TIME_NONE)
+        start_time_ = now;
+    last_time_ = now - start_time_;
+    guint64 index = frame_index_++;
+
+    // all buffers in use, or frame of another size: drop
+    if (pbo_pending_ >= PBO_COUNT || frame->width() != width_ || frame->height() != height_) {
+        dropped_++;
+        return;
+    }
+
+    // asynchronous read of the frame into the next pixel buffer
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[pbo_next_]);
+    frame->readPixels();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fence_[pbo_next_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pts_[pbo_next_] = last_time_;
+    index_[pbo_next_] = index;
+    render_time_[pbo_next_] = g_get_monotonic_time();
+
+    pbo_next_ = (pbo_next_ + 1) % PBO_COUNT;
+    pbo_pending_++;
+}
+
+void FrameGrabber::pushFrames(bool wait)
+{
+    while (pbo_pending_ > 0) {
+
+        // oldest pending read
+        int i = (pbo_next_ - pbo_pending_ + PBO_COUNT) % PBO_COUNT;
+
+        // not finished reading; try again next frame (unless waiting)
+        GLenum status = glClientWaitSync( (GLsync) fence_[i], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                          wait ? GST_SECOND : 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            break;
+        glDeleteSync( (GLsync) fence_[i] );
+        fence_[i] = nullptr;
+        pbo_pending_--;
+
+        // pipeline too far behind: drop
+        if ( gst_app_src_get_current_level_bytes (GST_APP_SRC (src_)) >= max_queued_ * frame_size_ ) {
+            dropped_++;
+            continue;
+        }
+
+        // copy pixels to a buffer for the pipeline
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[i]);
+        void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_size_, GL_MAP_READ_BIT);
+        if (pixels) {
+            GstBuffer *buffer = gst_buffer_new_allocate (NULL, frame_size_, NULL);
+            gst_buffer_fill (buffer, 0, pixels, frame_size_);
+            GST_BUFFER_PTS (buffer) = pts_[i];
+            GST_BUFFER_OFFSET (buffer) = index_[i];
+            GST_BUFFER_OFFSET_END (buffer) = render_time_[i];
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+            // push (takes ownership of buffer)
+            if ( gst_app_src_push_buffer (GST_APP_SRC (src_), buffer) == GST_FLOW_OK ) {
+                frames_++;
+                // running average of latency
+                float l = static_cast<float>( g_get_monotonic_time() - render_time_[i] ) * 0.001f;
+                latency_ = frames_ > 1 ? 0.9f * latency_ + 0.1f * l : l;
+            }
+            else
+                dropped_++;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+void FrameGrabber::stop()
+{
+    if (pipeline_ == nullptr)
+        return;
+
+    if (src_) {
+        gst_object_unref (src_);
+        src_ = nullptr;
+    }
+
+    gst_element_set_state (pipeline_, GST_STATE_NULL);
+    gst_object_unref (pipeline_);
+    pipeline_ = nullptr;
+}
+
+int FrameGrabber::queued() const
+{
+    if (src_ == nullptr || frame_size_ == 0)
+        return pbo_pending_;
+
+    return pbo_pending_ + static_cast<int>( gst_app_src_get_current_level_bytes (GST_APP_SRC (src_)) / frame_size_ );
+}
+
+float FrameGrabber::duration() const
+{
+    return static_cast<float>( GST_TIME_AS_MSECONDS(last_time_) ) * 0.001f;
+}
@@ -0,0 +1,79 @@
+#ifndef FRAMEGRABBER_H
+#define FRAMEGRABBER_H
+
+#include <string>
+#include <cstdint>
+#include <gst/gst.h>
+
+class FrameBuffer;
+
+/**
+ * @brief The FrameGrabber class gives frame buffers to a GStreamer pipeline
+ *
+ * The render loop never waits for the GPU nor for the pipeline:
+ * - each frame is read into the next pixel pack buffer of a ring, and a
+ *   fence is inserted after the read;
+ * - buffers are mapped a frame or two later, once their fence is
+ *   signaled, and copied to an appsrc whose streaming thread runs the
+ *   rest of the pipeline;
+ * - a frame is dropped if all pixel buffers are still in use, or if the
+ *   pipeline is too far behind.
+ * Buffers are time stamped with the time their frame was rendered; their
+ * offset is the index of the frame (counting dropped frames), and their
+ * end offset is the monotonic time of rendering (in microseconds).
+ */
+class FrameGrabber
+{
+public:
+    FrameGrabber(uint width, uint height);
+    virtual ~FrameGrabber();
+
+    // start reading the frame, and give frames whose reading is complete
+    void addFrame(FrameBuffer *frame);
+    // give pending frames and stop the pipeline
+    virtual void stop();
+
+    inline bool failed() const { return failed_; }
+    inline uint width() const { return width_; }
+    inline uint height() const { return height_; }
+    inline int frames() const { return frames_; }
+    inline int dropped() const { return dropped_; }
+    // frames waiting to be processed by the pipeline
+    int queued() const;
+    // duration since first frame, in seconds
+    float duration() const;
+    // average time between rendering and giving a frame, in milliseconds
+    inline float latency() const { return latency_; }
+
+protected:
+    // create and start the pipeline "appsrc name=src ! description"
+    bool init(const std::string &description, bool live, size_t max_queued);
+    // give frames read (waiting for pending reads if wait is true)
+    void pushFrames(bool wait);
+
+    uint width_, height_;
+    size_t frame_size_;
+    size_t max_queued_;
+    GstElement *pipeline_;
+    GstElement *src_;
+    GstClockTime start_time_;
+    GstClockTime last_time_;
+    guint64 frame_index_;
+    int frames_;
+    int dropped_;
+    float latency_;
+    bool failed_;
+
+private:
+    // ring of pixel pack buffers, with the fence and times of their frame
+    static const int PBO_COUNT = 3;
+    uint pbo_[PBO_COUNT];
+    void *fence_[PBO_COUNT];
+    GstClockTime pts_[PBO_COUNT];
+    guint64 index_[PBO_COUNT];
+    gint64 render_time_[PBO_COUNT];
+    int pbo_next_;
+    int pbo_pending_;
+};
+
+#endif // FRAMEGRABBER_H
@@ -0,0 +1,249 @@
+#include "FramePacer.h"
+
+#include <thread>
+#include <cmath>
+#include <sys/resource.h>
+
+#include "defines.h"
+#include "Log.h"
+#include "Settings.h"
+#include "RenderingManager.h"
+#include "UserInterfaceManager.h"
+#include "TaskScheduler.h"
+#include "MediaPlayer.h"
+#include "Mixer.h"
+
+// maximum time without redraw of the user interface
+#define PACER_MAX_INTERFACE_DELAY std::chrono::milliseconds(200)
+// time without change before idle, and timeout of wait for events when idle
+#define PACER_IDLE_DELAY std::chrono::seconds(1)
+#define PACER_IDLE_TIMEOUT 0.25
+
+const char* FramePacer::stage_name[STAGE_COUNT] = { "tasks", "session update", "user interface" };
+
+FramePacer::FramePacer() : output_fps_(-1), interface_fps_(-1), output_rate_(0.f),
+    interval_index_(0), interval_count_(0), missed_(0), skipped_(0), missed_since_log_(0),
+    idle_(false), sleeping_(false), media_frames_(0), media_events_(0), pending_tasks_(0),
+    cpu_time_(0.0), draws_(0), cpu_usage_(0.f), draw_rate_(0.f)
+{
+    for (int i = 0; i < INTERVAL_COUNT; ++i)
+        intervals_[i] = 0.f;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        duration_[s] = 0.f;
+        longest_[s] = 0.f;
+    }
+    Clock::time_point now = Clock::now();
+    next_output_ = next_interface_ = last_interface_ = last_output_ = last_log_ = now;
+    last_activity_ = usage_time_ = now;
+}
+
+void FramePacer::configure()
+{
+    if ( output_fps_ == Settings::application.output_fps &&
+         interface_fps_ == Settings::application.interface_fps )
+        return;
+
+    output_fps_ = MAXI(Settings::application.output_fps, 0);
+    interface_fps_ = MAXI(Settings::application.interface_fps, 0);
+    output_period_ = output_fps_ > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / output_fps_
+                                     : Clock::duration::zero();
+    interface_period_ = interface_fps_ > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / interface_fps_
+                                           : Clock::duration::zero();
+    next_output_ = next_interface_ = Clock::now();
+
+    // paced output shall not wait for vertical sync of UI window
+    Rendering::manager().SetSwapInterval( output_fps_ > 0 ? 0 : 1 );
+}
+
+bool FramePacer::due(Stage stage)
+{
+    configure();
+
+    // idle and nothing happened: nothing to draw
+    if (sleeping_)
+        return stage == TASKS;
+
+    // not paced: all stages every loop
+    if (output_fps_ < 1)
+        return true;
+
+    Clock::time_point now = Clock::now();
+
+    if (stage == OUTPUT)
+        return now >= next_output_;
+
+    if (stage == INTERFACE) {
+        if (now < next_interface_)
+            return false;
+        // skip redraw if it would make next output late (unless too long without)
+        Clock::duration estimate = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<float, std::milli>(duration_[INTERFACE]) );
+        if ( now + estimate > next_output_ && now - last_interface_ < PACER_MAX_INTERFACE_DELAY ) {
+            skipped_++;
+            return false;
+        }
+        return true;
+    }
+
+    return true;
+}
+
+void FramePacer::begin(Stage stage)
+{
+    Clock::time_point now = Clock::now();
+    start_[stage] = now;
+
+    if (stage == TASKS)
+        return;
+    draws_++;
+    if (stage != OUTPUT)
+        return;
+
+    // rate of output
+    float d = std::chrono::duration<float>(now - last_output_).count();
+    if (d > 0.f)
+        output_rate_ = output_rate_ > 0.f ? 0.95f * output_rate_ + 0.05f / d : 1.f / d;
+    last_output_ = now;
+
+    // keep frame times (paced or not)
+    intervals_[interval_index_] = d * 1000.f;
+    interval_index_ = (interval_index_ + 1) % INTERVAL_COUNT;
+    interval_count_ = MINI(interval_count_ + 1, INTERVAL_COUNT);
+
+    if (output_fps_ > 0) {
+        // missed deadline: output frame starts later than a period after its time
+        if ( now > next_output_ + output_period_ ) {
+            int missed = static_cast<int>( (now - next_output_) / output_period_ );
+            missed_ += missed;
+            missed_since_log_ += missed;
+
+            // the cause is the longest stage since previous output frame
+            int cause = 0;
+            for (int s = 1; s < STAGE_COUNT; ++s)
+                if (longest_[s] > longest_[cause])
+                    cause = s;
+            last_cause_ = std::string(stage_name[cause]);
+
+            // log at most every second
+            if (now - last_log_ > std::chrono::seconds(1)) {
+                Log::Info("Output missed %d frame(s): %s took %.1f ms (period %.1f ms).", missed_since_log_,
+                          stage_name[cause], longest_[cause],
+                          std::chrono::duration<float, std::milli>(output_period_).count());
+                missed_since_log_ = 0;
+                last_log_ = now;
+            }
+        }
+
+        // next deadline (no burst to catch up missed frames)
+        next_output_ += output_period_;
+        if (next_output_ < now)
+            next_output_ = now + output_period_;
+    }
+
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        longest_[s] = 0.f;
+}
+
+void FramePacer::end(Stage stage)
+{
+    Clock::time_point now = Clock::now();
+    duration_[stage] = std::chrono::duration<float, std::milli>(now - start_[stage]).count();
+    longest_[stage] = MAXI(longest_[stage], duration_[stage]);
+
+    if (stage == INTERFACE) {
+        last_interface_ = now;
+        next_interface_ += interface_period_;
+        if (next_interface_ < now)
+            next_interface_ = now;
+    }
+}
+
+bool FramePacer::checkIdle()
+{
+    if ( !Settings::application.idle || Rendering::manager().isHeadless() ) {
+        idle_ = false;
+        return idle_;
+    }
+
+    Clock::time_point now = Clock::now();
+
+    // any change is an activity
+    uint64_t frames = MediaPlayer::framesUploaded();
+    uint64_t events = MediaPlayer::mediaEvents();
+    unsigned int pending = TaskScheduler::manager().pendingTasks();
+    if ( frames != media_frames_ || events != media_events_ || pending != pending_tasks_ ||
+         Mixer::manager().busy() || now - UserInterface::manager().lastInput() < PACER_IDLE_DELAY )
+        last_activity_ = now;
+    media_frames_ = frames;
+    media_events_ = events;
+    pending_tasks_ = pending;
+
+    idle_ = now - last_activity_ > PACER_IDLE_DELAY;
+    return idle_;
+}
+
+void FramePacer::measureUsage()
+{
+    Clock::time_point now = Clock::now();
+    float elapsed = std::chrono::duration<float>(now - usage_time_).count();
+    if (elapsed < 1.f)
+        return;
+
+    // CPU time of the process (user and system)
+    struct rusage usage;
+    if ( getrusage(RUSAGE_SELF, &usage) == 0 ) {
+        double cpu = static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+                + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 0.000001;
+        cpu_usage_ = static_cast<float>( 100.0 * (cpu - cpu_time_) / elapsed );
+        cpu_time_ = cpu;
+    }
+
+    draw_rate_ = static_cast<float>(draws_) / elapsed;
+    draws_ = 0;
+    usage_time_ = now;
+}
+
+void FramePacer::wait()
+{
+    measureUsage();
+
+    // nothing changes: wait for events (or timeout to check again)
+    if ( checkIdle() ) {
+        unsigned int events = Rendering::manager().events();
+        Rendering::manager().WaitEvents(PACER_IDLE_TIMEOUT);
+        // no event of window, nor of media (since checked): nothing to draw
+        sleeping_ = events == Rendering::manager().events() && media_events_ == MediaPlayer::mediaEvents();
+        if (!sleeping_)
+            next_output_ = next_interface_ = Clock::now();
+        return;
+    }
+    sleeping_ = false;
+
+    // not paced: vertical sync of the UI window throttles the loop
+    if (output_fps_ < 1)
+        return;
+
+    // next output, or next redraw of interface if not already due (or skipped)
+    Clock::time_point next = next_output_;
+    if (interface_fps_ > 0 && next_interface_ > Clock::now() && next_interface_ < next)
+        next = next_interface_;
+
+    std::this_thread::sleep_until(next);
+}
+
+void FramePacer::outputFrameTime(float &mean, float &deviation, float &maximum) const
+{
+    mean = deviation = maximum = 0.f;
+    if (interval_count_ < 1)
+        return;
+
+    for (int i = 0; i < interval_count_; ++i) {
+        mean += intervals_[i];
+        maximum = MAXI(maximum, intervals_[i]);
+    }
+    mean /= static_cast<float>(interval_count_);
+
+    for (int i = 0; i < interval_count_; ++i)
+        deviation += (intervals_[i] - mean) * (intervals_[i] - mean);
+    deviation = sqrtf( deviation / static_cast<float>(interval_count_) );
+}
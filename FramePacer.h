@@ -0,0 +1,115 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief The FramePacer class schedules the stages of the main loop
+ *
+ * The session (output) is rendered at the output rate of the settings,
+ * with its own timing, and the user interface is redrawn at most at the
+ * interface rate. Under load, a redraw of the interface is skipped if it
+ * would make the next output frame late (but the interface is redrawn
+ * at least every 200 ms). When the output is paced, the UI window does
+ * not wait for vertical sync, and the loop sleeps until the next stage.
+ *
+ * An output frame starting later than its deadline is a missed deadline;
+ * it is logged with its cause, the longest stage since previous frame.
+ * Without output rate (0), all stages run every loop, throttled by the
+ * vertical sync of the UI window.
+ *
+ * Idle: if nothing changed for a while (no user input, no new frame of
+ * media, no background task finished, no edit of the session and no
+ * recording), the loop waits for events instead of drawing; on timeout
+ * only tasks are dispatched, and drawing resumes on the next event.
+ */
+class FramePacer
+{
+    // Private Constructor
+    FramePacer();
+    FramePacer(FramePacer const& copy);            // Not Implemented
+    FramePacer& operator=(FramePacer const& copy); // Not Implemented
+
+public:
+
+    static FramePacer& manager()
+    {
+        // The only instance
+        static FramePacer _instance;
+        return _instance;
+    }
+
+    typedef enum {
+        TASKS = 0,
+        OUTPUT,
+        INTERFACE,
+        STAGE_COUNT
+    } Stage;
+    static const char* stage_name[STAGE_COUNT];
+
+    // true if the stage shall run now
+    bool due(Stage stage);
+    // measure the stage
+    void begin(Stage stage);
+    void end(Stage stage);
+    // sleep until next stage is due
+    void wait();
+
+    // statistics
+    inline float outputRate() const { return output_rate_; }
+    // mean, standard deviation and maximum of output frame time
+    // over the last frames, in milliseconds
+    void outputFrameTime(float &mean, float &deviation, float &maximum) const;
+    inline int missedDeadlines() const { return missed_; }
+    inline int skippedInterface() const { return skipped_; }
+    inline std::string lastCause() const { return last_cause_; }
+    // duration of last run of stage, in milliseconds
+    inline float duration(Stage stage) const { return duration_[stage]; }
+    // true if waiting for events
+    inline bool idle() const { return idle_; }
+    // CPU time of the process (percent of one core) and number of
+    // stages drawn (output and interface) per second
+    inline float cpuUsage() const { return cpu_usage_; }
+    inline float drawRate() const { return draw_rate_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    void configure();
+    bool checkIdle();
+    void measureUsage();
+
+    int output_fps_, interface_fps_;
+    Clock::duration output_period_, interface_period_;
+    Clock::time_point next_output_, next_interface_, last_interface_, last_output_;
+    Clock::time_point start_[STAGE_COUNT];
+    float duration_[STAGE_COUNT];
+    // longest duration of stages since previous output frame
+    float longest_[STAGE_COUNT];
+    float output_rate_;
+    static const int INTERVAL_COUNT = 120;
+    float intervals_[INTERVAL_COUNT];
+    int interval_index_, interval_count_;
+    int missed_, skipped_;
+    std::string last_cause_;
+    Clock::time_point last_log_;
+    int missed_since_log_;
+
+    // idle
+    bool idle_;
+    bool sleeping_;
+    uint64_t media_frames_;
+    uint64_t media_events_;
+    unsigned int pending_tasks_;
+    Clock::time_point last_activity_;
+
+    // usage
+    Clock::time_point usage_time_;
+    double cpu_time_;
+    int draws_;
+    float cpu_usage_;
+    float draw_rate_;
+};
+
+#endif // FRAMEPACER_H
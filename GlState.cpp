@@ -0,0 +1,195 @@
+#include "GlState.h"
+
+#include <glad/glad.h>
+
+#define GLSTATE_UNKNOWN 0xFFFFFFFF
+#define GLSTATE_MAX_UNITS 8
+
+// cached state
+static GLuint program_ = GLSTATE_UNKNOWN;
+static GLuint blend_ = GLSTATE_UNKNOWN;
+static GLenum blend_equation_ = GLSTATE_UNKNOWN;
+static GLenum blend_sfactor_ = GLSTATE_UNKNOWN;
+static GLenum blend_dfactor_ = GLSTATE_UNKNOWN;
+static GLuint active_unit_ = GLSTATE_UNKNOWN;
+static GLuint textures_[GLSTATE_MAX_UNITS] = { GLSTATE_UNKNOWN, GLSTATE_UNKNOWN, GLSTATE_UNKNOWN, GLSTATE_UNKNOWN,
+                                              GLSTATE_UNKNOWN, GLSTATE_UNKNOWN, GLSTATE_UNKNOWN, GLSTATE_UNKNOWN };
+static GLuint framebuffer_ = GLSTATE_UNKNOWN;
+static glm::ivec4 viewport_ = glm::ivec4(-1);
+static glm::vec4 clear_color_ = glm::vec4(-1.f);
+static bool clear_color_valid_ = false;
+
+// statistics
+static unsigned int issued_ = 0;
+static unsigned int redundant_ = 0;
+static unsigned int frame_issued_ = 0;
+static unsigned int frame_redundant_ = 0;
+
+
+void GlState::useProgram(unsigned int program)
+{
+    if (program_ == program) {
+        redundant_++;
+        return;
+    }
+    program_ = program;
+    glUseProgram(program);
+    issued_++;
+}
+
+void GlState::enableBlend(bool on)
+{
+    if (blend_ == (GLuint) on) {
+        redundant_++;
+        return;
+    }
+    blend_ = (GLuint) on;
+    if (on)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+    issued_++;
+}
+
+void GlState::blendEquation(unsigned int mode)
+{
+    if (blend_equation_ == mode) {
+        redundant_++;
+        return;
+    }
+    blend_equation_ = mode;
+    glBlendEquation(mode);
+    issued_++;
+}
+
+void GlState::blendFunc(unsigned int sfactor, unsigned int dfactor)
+{
+    if (blend_sfactor_ == sfactor && blend_dfactor_ == dfactor) {
+        redundant_++;
+        return;
+    }
+    blend_sfactor_ = sfactor;
+    blend_dfactor_ = dfactor;
+    glBlendFunc(sfactor, dfactor);
+    issued_++;
+}
+
+void GlState::bindTexture(unsigned int unit, unsigned int texture)
+{
+    if (unit >= GLSTATE_MAX_UNITS)
+        return;
+
+    // the unit is made active even if the texture is already bound, as
+    // callers may edit the texture (upload, mipmaps, parameters)
+    if (active_unit_ != unit) {
+        active_unit_ = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        issued_++;
+    }
+    if (textures_[unit] == texture) {
+        redundant_++;
+        return;
+    }
+    textures_[unit] = texture;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    issued_++;
+}
+
+void GlState::deleteTexture(unsigned int texture)
+{
+    if (texture == 0)
+        return;
+
+    glDeleteTextures(1, &texture);
+
+    // deleted texture is unbound from all units
+    for (int u = 0; u < GLSTATE_MAX_UNITS; ++u) {
+        if (textures_[u] == texture)
+            textures_[u] = 0;
+    }
+}
+
+void GlState::bindFramebuffer(unsigned int framebuffer)
+{
+    if (framebuffer_ == framebuffer) {
+        redundant_++;
+        return;
+    }
+    framebuffer_ = framebuffer;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    issued_++;
+}
+
+void GlState::deleteFramebuffer(unsigned int framebuffer)
+{
+    if (framebuffer == 0)
+        return;
+
+    glDeleteFramebuffers(1, &framebuffer);
+
+    // deleted framebuffer reverts binding to default
+    if (framebuffer_ == framebuffer)
+        framebuffer_ = 0;
+}
+
+void GlState::invalidateFramebuffer()
+{
+    framebuffer_ = GLSTATE_UNKNOWN;
+}
+
+void GlState::viewport(int x, int y, int width, int height)
+{
+    glm::ivec4 v(x, y, width, height);
+    if (viewport_ == v) {
+        redundant_++;
+        return;
+    }
+    viewport_ = v;
+    glViewport(x, y, width, height);
+    issued_++;
+}
+
+void GlState::clearColor(glm::vec4 color)
+{
+    if (clear_color_valid_ && clear_color_ == color) {
+        redundant_++;
+        return;
+    }
+    clear_color_ = color;
+    clear_color_valid_ = true;
+    glClearColor(color.r, color.g, color.b, color.a);
+    issued_++;
+}
+
+void GlState::invalidate()
+{
+    program_ = GLSTATE_UNKNOWN;
+    blend_ = GLSTATE_UNKNOWN;
+    blend_equation_ = GLSTATE_UNKNOWN;
+    blend_sfactor_ = GLSTATE_UNKNOWN;
+    blend_dfactor_ = GLSTATE_UNKNOWN;
+    active_unit_ = GLSTATE_UNKNOWN;
+    for (int u = 0; u < GLSTATE_MAX_UNITS; ++u)
+        textures_[u] = GLSTATE_UNKNOWN;
+    framebuffer_ = GLSTATE_UNKNOWN;
+    viewport_ = glm::ivec4(-1);
+    clear_color_valid_ = false;
+}
+
+void GlState::frameStatistics()
+{
+    frame_issued_ = issued_;
+    frame_redundant_ = redundant_;
+    issued_ = 0;
+    redundant_ = 0;
+}
+
+unsigned int GlState::issuedCalls()
+{
+    return frame_issued_;
+}
+
+unsigned int GlState::redundantCalls()
+{
+    return frame_redundant_;
+}
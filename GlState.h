@@ -0,0 +1,46 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glm/glm.hpp>
+
+// Cache of the OpenGL state of the rendering context
+// All changes of program, blending, textures, framebuffer, viewport and
+// clear color go through these functions which skip calls that would set
+// the value already in place.
+// Must be called from the thread of the OpenGL context
+namespace GlState
+{
+    // program
+    void useProgram(unsigned int program);
+
+    // blending
+    void enableBlend(bool on);
+    void blendEquation(unsigned int mode);
+    void blendFunc(unsigned int sfactor, unsigned int dfactor);
+
+    // 2D textures bound per texture unit (the unit is left active)
+    void bindTexture(unsigned int unit, unsigned int texture);
+    void deleteTexture(unsigned int texture);
+
+    // framebuffer (draw & read)
+    void bindFramebuffer(unsigned int framebuffer);
+    void deleteFramebuffer(unsigned int framebuffer);
+    // forget about the cached framebuffer only, to call after binding
+    // read or draw framebuffers directly (e.g. to blit)
+    void invalidateFramebuffer();
+
+    // viewport and clear color
+    void viewport(int x, int y, int width, int height);
+    void clearColor(glm::vec4 color);
+
+    // forget about the cached state, to call when the GL state
+    // may have been modified otherwise (e.g. by ImGui rendering)
+    void invalidate();
+
+    // statistics of the last frame
+    void frameStatistics();
+    unsigned int issuedCalls();
+    unsigned int redundantCalls();
+}
+
+#endif // GLSTATE_H
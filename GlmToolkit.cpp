@@ -6,6 +6,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/random.hpp>
 
+#include <algorithm>
+
 glm::mat4 GlmToolkit::transform(glm::vec3 translation, glm::vec3 rotation, glm::vec3 scale)
 {
     glm::mat4 View = glm::translate(glm::identity<glm::mat4>(), translation);
@@ -134,3 +136,120 @@ GlmToolkit::AxisAlignedBoundingBox GlmToolkit::AxisAlignedBoundingBox::scaled(gl
     return bb;
 }
 
+
+GlmToolkit::AxisAlignedBoundingBox GlmToolkit::AxisAlignedBoundingBox::transformed(glm::mat4 m)
+{
+    GlmToolkit::AxisAlignedBoundingBox bb;
+    if (isNull())
+        return bb;
+
+    // extend with the 8 transformed corners
+    for (int c = 0; c < 8; ++c) {
+        glm::vec4 corner( c & 1 ? mMax.x : mMin.x, c & 2 ? mMax.y : mMin.y, c & 4 ? mMax.z : mMin.z, 1.f);
+        bb.extend( glm::vec3(m * corner) );
+    }
+
+    return bb;
+}
+
+
+void GlmToolkit::BoundingVolumeHierarchy::clear()
+{
+    elements_.clear();
+    leaves_.clear();
+}
+
+void GlmToolkit::BoundingVolumeHierarchy::build(const std::vector<AxisAlignedBoundingBox> &boxes)
+{
+    clear();
+    if (boxes.empty())
+        return;
+
+    elements_.reserve( 2 * boxes.size() );
+    leaves_.resize( boxes.size(), -1 );
+
+    std::vector<int> indices(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i)
+        indices[i] = i;
+
+    build(indices, 0, indices.size(), boxes);
+}
+
+int GlmToolkit::BoundingVolumeHierarchy::build(std::vector<int> &indices, size_t begin, size_t end,
+                                               const std::vector<AxisAlignedBoundingBox> &boxes)
+{
+    // NB: a branch is always stored before its children (used in refit)
+    int e = elements_.size();
+    elements_.push_back( Element() );
+
+    // one leaf
+    if (end - begin == 1) {
+        elements_[e].box = boxes[indices[begin]];
+        elements_[e].left = elements_[e].right = -1;
+        elements_[e].leaf = indices[begin];
+        leaves_[indices[begin]] = e;
+        return e;
+    }
+
+    // split along the largest axis of the centers, at the median
+    AxisAlignedBoundingBox centers;
+    for (size_t i = begin; i < end; ++i)
+        centers.extend( boxes[indices[i]].center() );
+    glm::vec3 d = centers.max() - centers.min();
+    int axis = d.x > d.y ? 0 : 1;
+    size_t middle = begin + (end - begin) / 2;
+    std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+                     [&boxes, axis](int a, int b) { return boxes[a].center()[axis] < boxes[b].center()[axis]; } );
+
+    int left = build(indices, begin, middle, boxes);
+    int right = build(indices, middle, end, boxes);
+
+    elements_[e].left = left;
+    elements_[e].right = right;
+    elements_[e].leaf = -1;
+    elements_[e].box = elements_[left].box;
+    elements_[e].box.extend( elements_[right].box );
+
+    return e;
+}
+
+void GlmToolkit::BoundingVolumeHierarchy::update(size_t leaf, const AxisAlignedBoundingBox &box)
+{
+    if (leaf < leaves_.size())
+        elements_[ leaves_[leaf] ].box = box;
+}
+
+void GlmToolkit::BoundingVolumeHierarchy::refit()
+{
+    // children are after their parent: update from the end
+    for (int e = elements_.size() - 1; e >= 0; --e) {
+        if (elements_[e].leaf < 0) {
+            elements_[e].box = elements_[ elements_[e].left ].box;
+            elements_[e].box.extend( elements_[ elements_[e].right ].box );
+        }
+    }
+}
+
+std::vector<int> GlmToolkit::BoundingVolumeHierarchy::query(glm::vec3 point, bool ignore_z) const
+{
+    std::vector<int> result;
+    if (elements_.empty())
+        return result;
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while ( !stack.empty() ) {
+        const Element &e = elements_[stack.back()];
+        stack.pop_back();
+        if ( !e.box.contains(point, ignore_z) )
+            continue;
+        if (e.leaf < 0) {
+            stack.push_back(e.left);
+            stack.push_back(e.right);
+        }
+        else
+            result.push_back(e.leaf);
+    }
+
+    return result;
+}
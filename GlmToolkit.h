@@ -40,6 +40,39 @@ public:
 
     AxisAlignedBoundingBox translated(glm::vec3 t);
     AxisAlignedBoundingBox scaled(glm::vec3 s);
+    AxisAlignedBoundingBox transformed(glm::mat4 m);
+};
+
+
+// Bounding Volume Hierarchy of axis aligned bounding boxes
+// Leaves are identified by their index in the list given to build()
+class BoundingVolumeHierarchy
+{
+    struct Element {
+        AxisAlignedBoundingBox box;
+        int left, right;   // children elements
+        int leaf;          // index of leaf, or -1 for a branch
+    };
+    std::vector<Element> elements_;
+    std::vector<int> leaves_;
+
+    int build(std::vector<int> &indices, size_t begin, size_t end,
+              const std::vector<AxisAlignedBoundingBox> &boxes);
+
+public:
+    BoundingVolumeHierarchy() {}
+
+    // build the hierarchy from the bounding boxes of the leaves
+    void build(const std::vector<AxisAlignedBoundingBox> &boxes);
+    void clear();
+    inline size_t size() const { return leaves_.size(); }
+
+    // change the bounding box of a leaf, then call refit() to update branches
+    void update(size_t leaf, const AxisAlignedBoundingBox &box);
+    void refit();
+
+    // get indices of all leaves containing the point
+    std::vector<int> query(glm::vec3 point, bool ignore_z = true) const;
 };
 
 }
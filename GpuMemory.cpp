@@ -0,0 +1,37 @@
+#include "GpuMemory.h"
+
+#include "Settings.h"
+#include "FrameBuffer.h"
+#include "MediaPlayer.h"
+#include "Scene.h"
+
+size_t GpuMemory::renderTargets()
+{
+    return FrameBuffer::poolBytes();
+}
+
+size_t GpuMemory::textures()
+{
+    return MediaPlayer::textureBytes();
+}
+
+size_t GpuMemory::vertexArrays()
+{
+    return Primitive::vertexBytes();
+}
+
+size_t GpuMemory::used()
+{
+    return renderTargets() + textures() + vertexArrays();
+}
+
+size_t GpuMemory::budget()
+{
+    return (size_t) MAXI(Settings::application.gpu_budget, 0) * 1048576;
+}
+
+bool GpuMemory::overBudget()
+{
+    size_t b = budget();
+    return b > 0 && used() > b;
+}
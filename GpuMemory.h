@@ -0,0 +1,25 @@
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+#include <cstddef>
+
+// Accounting of the GPU memory allocated by the application:
+// render targets of frame buffers, textures of media players and
+// vertex arrays of primitives.
+// The budget is set in Settings (in MB, 0 for unlimited); when over
+// budget, sessions evict the render targets of inactive sources.
+// Must be called from the thread of the OpenGL context
+namespace GpuMemory
+{
+    // bytes used by render targets, media textures and vertex arrays
+    size_t renderTargets();
+    size_t textures();
+    size_t vertexArrays();
+    size_t used();
+
+    // budget in bytes (0 if unlimited)
+    size_t budget();
+    bool overBudget();
+}
+
+#endif // GPUMEMORY_H
@@ -22,6 +22,13 @@
 #include "ImGuiToolkit.h"
 #include "GstToolkit.h"
 #include "SystemToolkit.h"
+#include "Shader.h"
+#include "GlState.h"
+#include "FrameBuffer.h"
+#include "GpuMemory.h"
+#include "Mesh.h"
+#include "ImageFilter.h"
+#include "ImageProcessingShader.h"
 
 unsigned int textureicons = 0;
 std::map <ImGuiToolkit::font_style, ImFont*>fontmap;
@@ -768,6 +775,25 @@ void ImGuiToolkit::ShowStats(bool *p_open, int* p_corner)
         ImGui::Text("HiDPI (retina) %s", io.DisplayFramebufferScale.x > 1.f ? "on" : "off");
 //        ImGui::Text("DPI Scale (%.1f,%.1f)", io.DisplayFramebufferScale.x, io.DisplayFramebufferScale.y);
         ImGui::Text("Rendering %.1f FPS", io.Framerate);
+        ImGui::Text("Uniforms %u / %u", ShadingProgram::uniformUploads(), ShadingProgram::uniformRequests());
+        ImGui::Text("GL state %u / %u", GlState::issuedCalls(), GlState::issuedCalls() + GlState::redundantCalls());
+        if (GpuMemory::budget() > 0)
+            ImGui::Text("GPU %.1f / %.0f MB", (float) GpuMemory::used() / 1048576.f, (float) GpuMemory::budget() / 1048576.f);
+        else
+            ImGui::Text("GPU %.1f MB", (float) GpuMemory::used() / 1048576.f);
+        ImGui::Text("  Textures %.1f MB", (float) GpuMemory::textures() / 1048576.f);
+        ImGui::Text("  Vertices %.1f MB", (float) GpuMemory::vertexArrays() / 1048576.f);
+        ImGui::Text("    Meshes %u (%u VAO) %.1f ms", Mesh::instances(), Mesh::vertexArrays(), Mesh::loadingTime());
+        ImGui::Text("  Targets %.1f MB", (float) GpuMemory::renderTargets() / 1048576.f);
+        std::vector<FrameBuffer::PoolBucket> buckets = FrameBuffer::poolStatistics();
+        for (auto b = buckets.begin(); b != buckets.end(); b++)
+            ImGui::Text("    %ux%u%s%s%s%s %u+%u %.1f MB", b->width, b->height, b->alpha ? " A" : "",
+                        b->depth ? " D" : "", b->mipmap ? " M" : "", b->samples > 0 ? " MS" : "",
+                        b->used, b->free, (float) b->bytes / 1048576.f);
+        for (int f = 1; f < IM_ARRAYSIZE(ImageProcessingShader::filter_names); ++f) {
+            if (ImageFilter::gpuTime(f) > 0.f)
+                ImGui::Text("%s %.2f ms", ImageProcessingShader::filter_names[f], ImageFilter::gpuTime(f));
+        }
         ImGui::PopFont();
 
         if (ImGui::BeginPopupContextWindow())
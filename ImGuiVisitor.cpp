@@ -24,11 +24,20 @@
 #include "SystemToolkit.h"
 
 
-ImGuiVisitor::ImGuiVisitor()
+ImGuiVisitor::ImGuiVisitor() : source_(nullptr)
 {
 
 }
 
+void ImGuiVisitor::edit(std::function<void()> change)
+{
+    Source *s = source_;
+    Mixer::manager().post( [s, change]() {
+        if ( s == nullptr || Mixer::manager().session()->find(s) != Mixer::manager().session()->end() )
+            change();
+    });
+}
+
 void ImGuiVisitor::visit(Node &n)
 {
 
@@ -40,47 +49,62 @@ void ImGuiVisitor::visit(Group &n)
 //    if (ImGui::TreeNode(id.c_str(), "Group %d", n.id()))
 //    {
         // MODEL VIEW
+    Group *g = &n;
 
     if (ImGuiToolkit::ButtonIcon(1, 16)) {
-        n.translation_.x = 0.f;
-        n.translation_.y = 0.f;
-        n.rotation_.z = 0.f;
-        n.scale_.x = 1.f;
-        n.scale_.y = 1.f;
+        edit( [g]() {
+            g->translation_.x = 0.f;
+            g->translation_.y = 0.f;
+            g->rotation_.z = 0.f;
+            g->scale_.x = 1.f;
+            g->scale_.y = 1.f;
+        });
     }
     ImGui::SameLine(0, 10);
     ImGui::Text("Geometry");
 
     if (ImGuiToolkit::ButtonIcon(6, 15)) {
-        n.translation_.x = 0.f;
-        n.translation_.y = 0.f;
+        edit( [g]() {
+            g->translation_.x = 0.f;
+            g->translation_.y = 0.f;
+        });
     }
     ImGui::SameLine(0, 10);
     float translation[2] = { n.translation_.x, n.translation_.y};
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     if ( ImGui::SliderFloat2("Position", translation, -5.0, 5.0) )
     {
-        n.translation_.x = translation[0];
-        n.translation_.y = translation[1];
+        float x = translation[0], y = translation[1];
+        edit( [g, x, y]() {
+            g->translation_.x = x;
+            g->translation_.y = y;
+        });
     }
 
     if (ImGuiToolkit::ButtonIcon(18, 9))
-        n.rotation_.z = 0.f;
+        edit( [g]() { g->rotation_.z = 0.f; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderAngle("Angle", &(n.rotation_.z), -180.f, 180.f) ;
+    float angle = n.rotation_.z;
+    if ( ImGui::SliderAngle("Angle", &angle, -180.f, 180.f) )
+        edit( [g, angle]() { g->rotation_.z = angle; } );
 
     if (ImGuiToolkit::ButtonIcon(3, 15))  {
-        n.scale_.x = 1.f;
-        n.scale_.y = 1.f;
+        edit( [g]() {
+            g->scale_.x = 1.f;
+            g->scale_.y = 1.f;
+        });
     }
     ImGui::SameLine(0, 10);
     float scale[2] = { n.scale_.x, n.scale_.y} ;
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     if ( ImGui::SliderFloat2("Scale", scale, -5.0, 5.0, "%.2f") )
     {
-        n.scale_.x = scale[0];
-        n.scale_.y = scale[1];
+        float x = scale[0], y = scale[1];
+        edit( [g, x, y]() {
+            g->scale_.x = x;
+            g->scale_.y = y;
+        });
     }
 
 //        // loop over members of a group
@@ -144,18 +168,24 @@ void ImGuiVisitor::visit(MediaPlayer &n)
 void ImGuiVisitor::visit(Shader &n)
 {
     ImGui::PushID(n.id());
+    Shader *sh = &n;
 
     if (ImGuiToolkit::ButtonIcon(10, 2)) {
-        n.blending = Shader::BLEND_OPACITY;
-        n.color = glm::vec4(1.f, 1.f, 1.f, 1.f);
+        edit( [sh]() {
+            sh->blending = Shader::BLEND_OPACITY;
+            sh->color = glm::vec4(1.f, 1.f, 1.f, 1.f);
+        });
     }
     ImGui::SameLine(0, 10);
-    ImGui::ColorEdit3("Color", glm::value_ptr(n.color), ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel ) ;
+    // alpha is not edited here (changed in mixing view)
+    glm::vec3 color = glm::vec3(n.color);
+    if ( ImGui::ColorEdit3("Color", glm::value_ptr(color), ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel ) )
+        edit( [sh, color]() { sh->color = glm::vec4(color, sh->color.a); } );
     ImGui::SameLine(0, 5);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     int mode = n.blending;
     if (ImGui::Combo("Blending", &mode, "Normal\0Screen\0Inverse\0Addition\0Subtract\0") )
-        n.blending = Shader::BlendMode(mode);
+        edit( [sh, mode]() { sh->blending = Shader::BlendMode(mode); } );
 
     ImGui::PopID();
 }
@@ -163,18 +193,20 @@ void ImGuiVisitor::visit(Shader &n)
 void ImGuiVisitor::visit(ImageShader &n)
 {
     ImGui::PushID(n.id());
+    ImageShader *sh = &n;
 
     // get index of the mask used in this ImageShader
     int item_current = n.mask;
 
-    if (ImGuiToolkit::ButtonIcon(10, 3)) n.mask = 0;
+    if (ImGuiToolkit::ButtonIcon(10, 3))
+        edit( [sh]() { sh->mask = 0; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     // combo list of masks
     if ( ImGui::Combo("Mask", &item_current, ImageShader::mask_names, IM_ARRAYSIZE(ImageShader::mask_names) ) )
     {
         if (item_current < (int) ImageShader::mask_presets.size())
-            n.mask = item_current;
+            edit( [sh, item_current]() { sh->mask = item_current; } );
         else {
             // TODO ask for custom mask
         }
@@ -186,64 +218,97 @@ void ImGuiVisitor::visit(ImageShader &n)
 void ImGuiVisitor::visit(ImageProcessingShader &n)
 {
     ImGui::PushID(n.id());
+    ImageProcessingShader *sh = &n;
 
     if (ImGuiToolkit::ButtonIcon(4, 1)) {
-        n.brightness = 0.f;
-        n.contrast = 0.f;
+        edit( [sh]() {
+            sh->brightness = 0.f;
+            sh->contrast = 0.f;
+        });
     }
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     float bc[2] = { n.brightness, n.contrast};
     if ( ImGui::SliderFloat2("B & C", bc, -1.0, 1.0) )
     {
-        n.brightness = bc[0];
-        n.contrast = bc[1];
+        float b = bc[0], c = bc[1];
+        edit( [sh, b, c]() {
+            sh->brightness = b;
+            sh->contrast = c;
+        });
     }
 
-    if (ImGuiToolkit::ButtonIcon(2, 1)) n.saturation = 0.f;
+    if (ImGuiToolkit::ButtonIcon(2, 1))
+        edit( [sh]() { sh->saturation = 0.f; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderFloat("Saturation", &n.saturation, -1.0, 1.0);
+    float saturation = n.saturation;
+    if ( ImGui::SliderFloat("Saturation", &saturation, -1.0, 1.0) )
+        edit( [sh, saturation]() { sh->saturation = saturation; } );
 
-    if (ImGuiToolkit::ButtonIcon(12, 4)) n.hueshift = 0.f;
+    if (ImGuiToolkit::ButtonIcon(12, 4))
+        edit( [sh]() { sh->hueshift = 0.f; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderFloat("Hue shift", &n.hueshift, 0.0, 1.0);
+    float hueshift = n.hueshift;
+    if ( ImGui::SliderFloat("Hue shift", &hueshift, 0.0, 1.0) )
+        edit( [sh, hueshift]() { sh->hueshift = hueshift; } );
 
-    if (ImGuiToolkit::ButtonIcon(3, 1)) n.lumakey = 0.f;
+    if (ImGuiToolkit::ButtonIcon(3, 1))
+        edit( [sh]() { sh->lumakey = 0.f; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderFloat("Lumakey", &n.lumakey, 0.0, 1.0);
+    float lumakey = n.lumakey;
+    if ( ImGui::SliderFloat("Lumakey", &lumakey, 0.0, 1.0) )
+        edit( [sh, lumakey]() { sh->lumakey = lumakey; } );
 
-    if (ImGuiToolkit::ButtonIcon(8, 1)) n.threshold = 0.f;
+    if (ImGuiToolkit::ButtonIcon(8, 1))
+        edit( [sh]() { sh->threshold = 0.f; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderFloat("Threshold", &n.threshold, 0.0, 1.0, n.threshold < 0.001 ? "None" : "%.2f");
+    float threshold = n.threshold;
+    if ( ImGui::SliderFloat("Threshold", &threshold, 0.0, 1.0, threshold < 0.001 ? "None" : "%.2f") )
+        edit( [sh, threshold]() { sh->threshold = threshold; } );
 
-    if (ImGuiToolkit::ButtonIcon(18, 1)) n.nbColors = 0;
+    if (ImGuiToolkit::ButtonIcon(18, 1))
+        edit( [sh]() { sh->nbColors = 0; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderInt("Posterize", &n.nbColors, 0, 16, n.nbColors == 0 ? "None" : "%d colors");
+    int nbColors = n.nbColors;
+    if ( ImGui::SliderInt("Posterize", &nbColors, 0, 16, nbColors == 0 ? "None" : "%d colors") )
+        edit( [sh, nbColors]() { sh->nbColors = nbColors; } );
 
-    if (ImGuiToolkit::ButtonIcon(1, 7)) n.filterid = 0;
+    if (ImGuiToolkit::ButtonIcon(1, 7))
+        edit( [sh]() { sh->filterid = 0; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::Combo("Filter", &n.filterid, ImageProcessingShader::filter_names, IM_ARRAYSIZE(ImageProcessingShader::filter_names) );
+    int filterid = n.filterid;
+    if ( ImGui::Combo("Filter", &filterid, ImageProcessingShader::filter_names, IM_ARRAYSIZE(ImageProcessingShader::filter_names) ) )
+        edit( [sh, filterid]() { sh->filterid = filterid; } );
 
-    if (ImGuiToolkit::ButtonIcon(7, 1)) n.invert = 0;
+    if (ImGuiToolkit::ButtonIcon(7, 1))
+        edit( [sh]() { sh->invert = 0; } );
     ImGui::SameLine(0, 10);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::Combo("Invert", &n.invert, "None\0Invert Color\0Invert Luminance\0");
+    int invert = n.invert;
+    if ( ImGui::Combo("Invert", &invert, "None\0Invert Color\0Invert Luminance\0") )
+        edit( [sh, invert]() { sh->invert = invert; } );
 
     if (ImGuiToolkit::ButtonIcon(13, 4)) {
-        n.chromakey = glm::vec4(0.f, 1.f, 0.f, 1.f);
-        n.chromadelta = 0.f;
+        edit( [sh]() {
+            sh->chromakey = glm::vec4(0.f, 1.f, 0.f, 1.f);
+            sh->chromadelta = 0.f;
+        });
     }
     ImGui::SameLine(0, 10);
-    ImGui::ColorEdit3("Chroma color", glm::value_ptr(n.chromakey), ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel  ) ;
+    glm::vec4 chromakey = n.chromakey;
+    if ( ImGui::ColorEdit3("Chroma color", glm::value_ptr(chromakey), ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel  ) )
+        edit( [sh, chromakey]() { sh->chromakey = chromakey; } );
     ImGui::SameLine(0, 5);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
-    ImGui::SliderFloat("Chromakey", &n.chromadelta, 0.0, 1.0, n.chromadelta < 0.001 ? "None" : "Tolerance %.2f");
+    float chromadelta = n.chromadelta;
+    if ( ImGui::SliderFloat("Chromakey", &chromadelta, 0.0, 1.0, chromadelta < 0.001 ? "None" : "Tolerance %.2f") )
+        edit( [sh, chromadelta]() { sh->chromadelta = chromadelta; } );
 
     ImGui::PopID();
 }
@@ -251,6 +316,8 @@ void ImGuiVisitor::visit(ImageProcessingShader &n)
 
 void ImGuiVisitor::visit (Source& s)
 {
+    source_ = &s;
+
     // blending
     s.blendingShader()->accept(*this);
 
@@ -258,6 +325,7 @@ void ImGuiVisitor::visit (Source& s)
     float preview_width = ImGui::GetContentRegionAvail().x IMGUI_RIGHT_ALIGN;
     ImVec2 imagesize ( preview_width, preview_width / s.frame()->aspectRatio());
     ImGui::Image((void*)(uintptr_t) s.frame()->texture(), imagesize);
+    ImGui::Text("GPU %.1f MB%s", (float) s.gpuBytes() / 1048576.f, s.frame()->evicted() ? " (evicted)" : "");
 
     // image processing pannel
     s.processingShader()->accept(*this);
@@ -283,10 +351,11 @@ void ImGuiVisitor::visit (MediaSource& s)
 void ImGuiVisitor::visit (SessionSource& s)
 {
     ImGui::Text("Session File");
+    SessionSource *ss = &s;
     if ( ImGui::Button("Make Current", ImVec2(IMGUI_RIGHT_ALIGN, 0)) )
-        Mixer::manager().set( s.detach() );
+        edit( [ss]() { Mixer::manager().set( ss->detach() ); } );
     if ( ImGui::Button( ICON_FA_FILE_IMPORT " Merge", ImVec2(IMGUI_RIGHT_ALIGN, 0)) )
-        Mixer::manager().merge( s.detach() );
+        edit( [ss]() { Mixer::manager().merge( ss->detach() ); } );
 
     ImGuiToolkit::ButtonOpenUrl( SystemToolkit::path_filename(s.path()).c_str(), ImVec2(IMGUI_RIGHT_ALIGN, 0) );
 }
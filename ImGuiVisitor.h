@@ -1,10 +1,18 @@
 #ifndef IMGUIVISITOR_H
 #define IMGUIVISITOR_H
 
+#include <functional>
+
 #include "Visitor.h"
 
 class ImGuiVisitor: public Visitor
 {
+    // source edited (nullptr if none)
+    Source *source_;
+    // edits are applied by the mixer between frames, unless the source
+    // was deleted in the meantime
+    void edit(std::function<void()> change);
+
 public:
     ImGuiVisitor();
 
@@ -0,0 +1,214 @@
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "defines.h"
+#include "ImageFilter.h"
+#include "ImageProcessingShader.h"
+#include "FrameBuffer.h"
+#include "Primitives.h"
+#include "Shader.h"
+#include "GlState.h"
+
+// operations of a pass, matching defines of filter.fs
+typedef enum {
+    PASS_BLUR = 0,
+    PASS_EROSION,
+    PASS_DILATION,
+    PASS_COUNT
+} PassOperation;
+
+static ShadingProgram filterPassPrograms[PASS_COUNT] = {
+    ShadingProgram("shaders/image.vs", "shaders/filter.fs", "#define BLUR\n"),
+    ShadingProgram("shaders/image.vs", "shaders/filter.fs", "#define EROSION\n"),
+    ShadingProgram("shaders/image.vs", "shaders/filter.fs", "#define DILATION\n")
+};
+
+// Shader of a pass: no blending (alpha is copied)
+class FilterPassShader : public Shader
+{
+public:
+    int operation;
+    glm::vec2 step;
+
+    FilterPassShader() : Shader(), operation(PASS_BLUR), step(0.f) {
+        blending = BLEND_CUSTOM;
+    }
+
+    void use() override {
+        program_ = &filterPassPrograms[operation];
+        Shader::use();
+        GlState::enableBlend(false);
+        program_->setUniform(ShadingProgram::UNIFORM_FILTERSTEP, step);
+    }
+};
+
+// statistics of GPU time per filter (nanoseconds)
+static const int FILTER_COUNT = sizeof(ImageProcessingShader::filter_names) / sizeof(ImageProcessingShader::filter_names[0]);
+static GLuint64 time_elapsed_[FILTER_COUNT] = {};
+static float frame_time_[FILTER_COUNT] = {};
+
+// operation and radius of separable filters (radius 0 if not separable)
+// NB: denoising, erosion and dilation up to 7x7 keep their disc shaped
+// kernel and are computed in ImageProcessingShader
+static void filterPasses(int filterid, std::vector<PassOperation> &operations, std::vector<int> &radius)
+{
+    switch (filterid) {
+    case 1: // Blur
+        operations.push_back(PASS_BLUR);     radius.push_back(1);
+        break;
+    case 12: case 13: // Erosion 15x15, 31x31
+        operations.push_back(PASS_EROSION);  radius.push_back(filterid == 12 ? 7 : 15);
+        break;
+    case 14: case 15: // Dilation 15x15, 31x31
+        operations.push_back(PASS_DILATION); radius.push_back(filterid == 14 ? 7 : 15);
+        break;
+    default:
+        break;
+    }
+}
+
+bool ImageFilter::separable(int filterid)
+{
+    std::vector<PassOperation> operations;
+    std::vector<int> radius;
+    filterPasses(filterid, operations, radius);
+    return !operations.empty();
+}
+
+ImageFilter::ImageFilter() : next_query_(0)
+{
+    buffers_[0] = buffers_[1] = nullptr;
+    shader_ = new FilterPassShader;
+    surface_ = new Surface(shader_);
+
+    for (int q = 0; q < QUERY_COUNT; ++q) {
+        queries_[q] = 0;
+        query_filter_[q] = 0;
+        query_pending_[q] = false;
+    }
+}
+
+ImageFilter::~ImageFilter()
+{
+    // give back intermediate frame buffers to the pool
+    if (buffers_[0])
+        delete buffers_[0];
+    if (buffers_[1])
+        delete buffers_[1];
+
+    // surface deletes its shader
+    delete surface_;
+
+    for (int q = 0; q < QUERY_COUNT; ++q) {
+        if (queries_[q])
+            glDeleteQueries(1, &queries_[q]);
+    }
+}
+
+void ImageFilter::pass(uint texture, FrameBuffer *target, int operation, glm::vec2 step)
+{
+    static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -1.f, 1.f);
+
+    shader_->operation = operation;
+    shader_->step = step;
+    surface_->setTextureIndex(texture);
+
+    target->begin();
+    surface_->draw(glm::identity<glm::mat4>(), projection);
+    target->end();
+}
+
+void ImageFilter::collectQueries()
+{
+    for (int q = 0; q < QUERY_COUNT; ++q) {
+        if (!query_pending_[q])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries_[q], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries_[q], GL_QUERY_RESULT, &elapsed);
+            time_elapsed_[ query_filter_[q] ] += elapsed;
+            query_pending_[q] = false;
+        }
+    }
+}
+
+uint ImageFilter::apply(uint texture, int filterid, glm::vec3 resolution)
+{
+    std::vector<PassOperation> operations;
+    std::vector<int> radius;
+    filterPasses(filterid, operations, radius);
+
+    // not a separable filter
+    if (operations.empty()) {
+        // release intermediate buffers if not used anymore
+        for (int b = 0; b < 2; ++b) {
+            if (buffers_[b]) {
+                delete buffers_[b];
+                buffers_[b] = nullptr;
+            }
+        }
+        return texture;
+    }
+
+    // (re)create intermediate buffers at given resolution (from the pool)
+    for (int b = 0; b < 2; ++b) {
+        if (buffers_[b] && buffers_[b]->resolution() != resolution) {
+            delete buffers_[b];
+            buffers_[b] = nullptr;
+        }
+        if (!buffers_[b])
+            buffers_[b] = new FrameBuffer(resolution, true);
+    }
+
+    // measure GPU time (skip if no query is free)
+    collectQueries();
+    int q = next_query_;
+    bool timing = !query_pending_[q];
+    if (timing) {
+        if (!queries_[q])
+            glGenQueries(1, &queries_[q]);
+        glBeginQuery(GL_TIME_ELAPSED, queries_[q]);
+    }
+
+    // passes along x and y, with steps growing by powers of 2 up to radius
+    glm::vec2 texel = glm::vec2(1.f / resolution.x, 1.f / resolution.y);
+    uint input = texture;
+    for (size_t o = 0; o < operations.size(); ++o) {
+        int remaining = radius[o];
+        for (int s = 1; remaining > 0; s *= 2) {
+            int step = MINI(s, remaining);
+            remaining -= step;
+            pass(input, buffers_[0], operations[o], glm::vec2(texel.x * step, 0.f));
+            pass(buffers_[0]->texture(), buffers_[1], operations[o], glm::vec2(0.f, texel.y * step));
+            input = buffers_[1]->texture();
+        }
+    }
+
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        query_filter_[q] = filterid;
+        query_pending_[q] = true;
+        next_query_ = (next_query_ + 1) % QUERY_COUNT;
+    }
+
+    return input;
+}
+
+void ImageFilter::frameStatistics()
+{
+    for (int f = 0; f < FILTER_COUNT; ++f) {
+        frame_time_[f] = static_cast<float>(time_elapsed_[f]) * 0.000001f;
+        time_elapsed_[f] = 0;
+    }
+}
+
+float ImageFilter::gpuTime(int filterid)
+{
+    if (filterid < 0 || filterid >= FILTER_COUNT)
+        return 0.f;
+    return frame_time_[filterid];
+}
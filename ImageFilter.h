@@ -0,0 +1,57 @@
+#ifndef IMAGEFILTER_H
+#define IMAGEFILTER_H
+
+#include <glm/glm.hpp>
+
+class FrameBuffer;
+class Surface;
+class FilterPassShader;
+
+/**
+ * @brief The ImageFilter class applies separable filters in several passes
+ *
+ * Blur, and erosion and dilation 15x15 and 31x31, are computed by
+ * successive passes of 3 taps along x then y, in two intermediate
+ * frame buffers (taken from the FrameBuffer pool). Larger kernels use
+ * growing steps between taps: a (2r+1)x(2r+1) square kernel costs
+ * 6 texture fetches per pixel and per power of 2 in r.
+ * The other filters (sharpen, edge, emboss, denoising, and erosion and
+ * dilation up to 7x7 with their disc shaped kernel) are computed in
+ * ImageProcessingShader.
+ *
+ * GPU time of the passes is measured with timer queries, per filter.
+ */
+class ImageFilter
+{
+public:
+    ImageFilter();
+    ~ImageFilter();
+
+    // true if the filter is computed by ImageFilter (not in ImageProcessingShader)
+    static bool separable(int filterid);
+
+    // apply the filter on the texture, in frame buffers of given resolution
+    // returns the texture to process instead of the given one
+    uint apply(uint texture, int filterid, glm::vec3 resolution);
+
+    // GPU time of each filter during last frame (in milliseconds)
+    static void frameStatistics();
+    static float gpuTime(int filterid);
+
+private:
+    void pass(uint texture, FrameBuffer *target, int operation, glm::vec2 step);
+    void collectQueries();
+
+    FrameBuffer *buffers_[2];
+    Surface *surface_;
+    FilterPassShader *shader_;
+
+    // ring of timer queries, with the filter they measure
+    static const int QUERY_COUNT = 3;
+    uint queries_[QUERY_COUNT];
+    int query_filter_[QUERY_COUNT];
+    bool query_pending_[QUERY_COUNT];
+    int next_query_;
+};
+
+#endif // IMAGEFILTER_H
@@ -1,42 +1,203 @@
+#include <cstring>
+#include <vector>
+#include <map>
+#include <list>
+#include <mutex>
+
+#include <glad/glad.h>
+
 #include "defines.h"
 #include "Visitor.h"
 #include "Log.h"
 #include "ImageProcessingShader.h"
+#include "ImageFilter.h"
+
+// Effects of imageprocessing.fs enabled by a define, by bit in the program variant
+// (filter id is in the upper bits of the variant)
+static const char* effect_defines[10] = { "CHROMAKEY", "BRIGHTNESS_CONTRAST", "LEVELS", "INVERT", "INVERT_LUMINANCE",
+                                          "HUESHIFT", "SATURATION", "POSTERIZE", "LUMAKEY", "THRESHOLD" };
+#define VARIANT_FILTER_SHIFT 16
 
-ShadingProgram imageProcessingShadingProgram("shaders/image.vs", "shaders/imageprocessing.fs");
+// Programs for each variant used, compiled on first use
+static std::map<uint, ShadingProgram *> imageProcessingShadingPrograms;
+static std::mutex imageProcessingShadingProgramsAccess;
 
-const char* ImageProcessingShader::filter_names[12] = { "None", "Blur", "Sharpen", "Edge", "Emboss", "Denoising",
-                                                        "Erosion 3x3", "Erosion 5x5", "Erosion 7x7", "Dilation 3x3", "Dilation 5x5", "Dilation 7x7" };
+static ShadingProgram *imageProcessingShadingProgram(uint variant)
+{
+    std::lock_guard<std::mutex> lock(imageProcessingShadingProgramsAccess);
+
+    auto it = imageProcessingShadingPrograms.find(variant);
+    if (it != imageProcessingShadingPrograms.end())
+        return it->second;
+
+    // create program with the defines of the variant
+    std::string defines;
+    for (uint e = 0; e < 10; ++e) {
+        if ( variant & (1 << e) )
+            defines += std::string("#define ") + effect_defines[e] + "\n";
+    }
+    uint filter = variant >> VARIANT_FILTER_SHIFT;
+    if ( filter > 0 )
+        defines += "#define FILTER " + std::to_string(filter) + "\n";
+
+    ShadingProgram *program = new ShadingProgram("shaders/image.vs", "shaders/imageprocessing.fs", defines);
+    imageProcessingShadingPrograms[variant] = program;
+    return program;
+}
 
+const char* ImageProcessingShader::filter_names[16] = { "None", "Blur", "Sharpen", "Edge", "Emboss", "Denoising",
+                                                        "Erosion 3x3", "Erosion 5x5", "Erosion 7x7", "Dilation 3x3", "Dilation 5x5", "Dilation 7x7",
+                                                        "Erosion 15x15", "Erosion 31x31", "Dilation 15x15", "Dilation 31x31" };
 
-ImageProcessingShader::ImageProcessingShader()
+// Uniform buffer shared by all ImageProcessingShaders, one slot per instance
+// Slots are reserved on creation (any thread), GL buffer is (re)allocated on use
+struct ParametersBuffer
+{
+    GLuint id;
+    GLsizeiptr stride;
+    uint capacity;
+    uint generation;
+    std::vector<bool> slots;
+    std::mutex access;
+
+    ParametersBuffer() : id(0), stride(0), capacity(0), generation(0) { }
+
+    uint acquire() {
+        std::lock_guard<std::mutex> lock(access);
+        uint s = 0;
+        for (; s < slots.size(); ++s) {
+            if (!slots[s])
+                break;
+        }
+        if (s < slots.size())
+            slots[s] = true;
+        else
+            slots.push_back(true);
+        return s;
+    }
+
+    void release(uint s) {
+        std::lock_guard<std::mutex> lock(access);
+        if (s < slots.size())
+            slots[s] = false;
+    }
+
+    // ensure the GL buffer can hold the given slot
+    void reserve(uint s) {
+        if (stride == 0) {
+            GLint alignment = 1;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            alignment = MAXI(alignment, 1);
+            stride = ( (sizeof(ImageProcessingShader::Parameters) + alignment - 1) / alignment ) * alignment;
+            glGenBuffers(1, &id);
+        }
+        if (s >= capacity) {
+            capacity = MAXI(capacity, 16u);
+            while (s >= capacity)
+                capacity *= 2;
+            glBindBuffer(GL_UNIFORM_BUFFER, id);
+            glBufferData(GL_UNIFORM_BUFFER, capacity * stride, NULL, GL_DYNAMIC_DRAW);
+            // content is lost: all slots have to be uploaded again
+            generation++;
+        }
+    }
+};
+
+static ParametersBuffer parameters_buffer;
+
+
+ImageProcessingShader::ImageProcessingShader() : generation_(0)
 {
-    program_ = &imageProcessingShadingProgram;
+    program_ = imageProcessingShadingProgram(0);
+    slot_ = parameters_buffer.acquire();
     reset();
 }
 
-void ImageProcessingShader::use()
+ImageProcessingShader::~ImageProcessingShader()
 {
-    Shader::use();
+    parameters_buffer.release(slot_);
+}
 
-//    program_->setUniform("iChannelResolution[0]", iChannelResolution[0].x, iChannelResolution[0].y, iChannelResolution[0].z);
+uint ImageProcessingShader::variant() const
+{
+    // effects which are not at their default values
+    bool enabled[10] = {
+        chromadelta > 0.0001f,
+        brightness != 0.f || contrast != 0.f,
+        levels != glm::vec4(0.f, 1.f, 0.f, 1.f) || gamma != glm::vec4(1.f),
+        invert == 1,
+        invert == 2,
+        hueshift != 0.f,
+        saturation != 0.f,
+        nbColors > 0,
+        lumakey > 0.000001f,
+        threshold > 0.000001f
+    };
+
+    uint v = 0;
+    for (uint e = 0; e < 10; ++e) {
+        if ( enabled[e] )
+            v |= 1 << e;
+    }
+    // separable filters are applied before, in passes (see ImageFilter)
+    if ( filterid > 0 && filterid < 16 && !ImageFilter::separable(filterid) )
+        v |= filterid << VARIANT_FILTER_SHIFT;
+
+    return v;
+}
 
-    program_->setUniform("brightness", brightness);
-    program_->setUniform("contrast", contrast);
-    program_->setUniform("saturation", saturation);
-    program_->setUniform("hueshift", hueshift);
+ImageProcessingShader::Parameters ImageProcessingShader::parameters() const
+{
+    Parameters p;
+    p.gamma = gamma;
+    p.levels = levels;
+    p.chromakey = chromakey;
+    p.brightness = brightness;
+    p.contrast = contrast;
+    p.saturation = saturation;
+    p.hueshift = hueshift;
+    p.threshold = threshold;
+    p.lumakey = lumakey;
+    p.chromadelta = chromadelta;
+    p.nbColors = nbColors;
+    p.invert = invert;
+    p.filterid = filterid;
+    p.padding[0] = p.padding[1] = 0.f;
+
+    return p;
+}
+
+void ImageProcessingShader::prewarm(const std::list<ImageProcessingShader *> &shaders)
+{
+    std::list<ShadingProgram *> programs;
+    for (auto it = shaders.begin(); it != shaders.end(); it++) {
+        if ( *it != nullptr )
+            programs.push_back( imageProcessingShadingProgram( (*it)->variant() ) );
+    }
+    ShadingProgram::prewarm(programs);
+}
+
+void ImageProcessingShader::use()
+{
+    // program specialized for the effects enabled
+    program_ = imageProcessingShadingProgram( variant() );
+
+    Shader::use();
 
-    program_->setUniform("threshold", threshold);
-    program_->setUniform("lumakey", lumakey);
-    program_->setUniform("nbColors", nbColors);
-    program_->setUniform("invert", invert);
-    program_->setUniform("filterid", filterid);
+    Parameters p = parameters();
 
-    program_->setUniform("gamma", gamma);
-    program_->setUniform("levels", levels);
-    program_->setUniform("chromakey", chromakey);
-    program_->setUniform("chromadelta", chromadelta);
+    // upload parameters only if changed since last upload in our slot
+    parameters_buffer.reserve(slot_);
+    GLintptr offset = slot_ * parameters_buffer.stride;
+    if ( generation_ != parameters_buffer.generation || memcmp(&p, &uploaded_, sizeof(Parameters)) != 0 ) {
+        glBindBuffer(GL_UNIFORM_BUFFER, parameters_buffer.id);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(Parameters), &p);
+        generation_ = parameters_buffer.generation;
+        uploaded_ = p;
+    }
 
+    glBindBufferRange(GL_UNIFORM_BUFFER, ShadingProgram::BLOCK_IMAGEPROCESSING,
+                      parameters_buffer.id, offset, sizeof(Parameters));
 }
 
 
@@ -11,7 +11,7 @@ class ImageProcessingShader : public Shader
 public:
 
     ImageProcessingShader();
-//    virtual ~ImageProcessingShader() {}
+    ~ImageProcessingShader();
 
     void use() override;
     void reset() override;
@@ -42,8 +42,41 @@ public:
     // [5] 1 x convolution opening (denoising)
     // [6 11] 6 x convolutions: erosion 3x3, 5x5, 7x7, dilation 3x3, 5x5, 7x7
     int filterid;
-    static const char* filter_names[12];
+    static const char* filter_names[16];
 
+    // Parameters as given to the shader in uniform block 'ImageProcessing'
+    // NB: must match std140 layout of block in imageprocessing.fs
+    struct Parameters {
+        glm::vec4 gamma;
+        glm::vec4 levels;
+        glm::vec4 chromakey;
+        float brightness;
+        float contrast;
+        float saturation;
+        float hueshift;
+        float threshold;
+        float lumakey;
+        float chromadelta;
+        int   nbColors;
+        int   invert;
+        int   filterid;
+        float padding[2];
+    };
+
+    // current values of parameters
+    Parameters parameters() const;
+
+    // initialize the program variants used by the given shaders
+    static void prewarm(const std::list<ImageProcessingShader *> &shaders);
+
+private:
+    // variant of the program matching the effects enabled
+    uint variant() const;
+
+    // slot in the uniform buffer shared by all ImageProcessingShaders
+    uint slot_;
+    uint generation_;
+    Parameters uploaded_;
 };
 
 
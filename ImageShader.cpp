@@ -4,6 +4,7 @@
 #include "Visitor.h"
 #include "ImageShader.h"
 #include "Resource.h"
+#include "GlState.h"
 
 static ShadingProgram imageShadingProgram("shaders/image.vs", "shaders/image.fs");
 
@@ -34,14 +35,12 @@ void ImageShader::use()
 {
     Shader::use();
 
-    program_->setUniform("stipple", stipple);
+    program_->setUniform(ShadingProgram::UNIFORM_STIPPLE, stipple);
 
-    glActiveTexture(GL_TEXTURE1);
     if ( mask < 9 )
-        glBindTexture(GL_TEXTURE_2D, mask_presets[mask]);
+        GlState::bindTexture(1, mask_presets[mask]);
     else
-        glBindTexture(GL_TEXTURE_2D, custom_textureindex);
-    glActiveTexture(GL_TEXTURE0);
+        GlState::bindTexture(1, custom_textureindex);
 
 }
 
@@ -15,9 +15,12 @@
 #include <string>
 #include <list>
 #include <mutex>
+#include <cstdio>
+#include <cstdarg>
 using namespace std;
 
 static std::mutex mtx;
+static bool console = false;
 
 struct AppLog
 {
@@ -41,6 +44,14 @@ struct AppLog
 
     void AddLog(const char* fmt, va_list args)
     {
+        if (console) {
+            va_list console_args;
+            va_copy(console_args, args);
+            vprintf(fmt, console_args);
+            printf("\n");
+            va_end(console_args);
+        }
+
         mtx.lock();
         int old_size = Buf.size();
         Buf.appendfv(fmt, args);
@@ -138,6 +149,11 @@ struct AppLog
 
 static AppLog logs;
 
+void Log::SetConsole(bool on)
+{
+    console = on;
+}
+
 void Log::Info(const char* fmt, ...)
 {
     va_list args;
@@ -9,6 +9,9 @@ namespace Log
     void Warning(const char* fmt, ...);
     void Error(const char* fmt, ...);
 
+    // also print logs in the console (e.g. without user interface)
+    void SetConsole(bool on);
+
     // Draw logs
     void ShowLogWindow(bool* p_open = nullptr);
 
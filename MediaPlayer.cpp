@@ -10,6 +10,7 @@
 #include "UserInterfaceManager.h"
 #include "SystemToolkit.h"
 #include "GstToolkit.h"
+#include "GlState.h"
 
 //  Desktop OpenGL function loader
 #include <glad/glad.h>  
@@ -42,6 +43,8 @@ MediaPlayer::MediaPlayer(string name) : id_(name)
     interlaced_ = false;
     need_loop_ = false;
     v_frame_is_full_ = false;
+    offline_ = false;
+    offline_target_ = GST_CLOCK_TIME_NONE;
     rate_ = 1.0;
     framerate_ = 0.0;
 
@@ -57,6 +60,8 @@ MediaPlayer::MediaPlayer(string name) : id_(name)
     v_frame_.buffer = nullptr;
 
     textureindex_ = 0;
+    texturebytes_ = 0;
+    texture_updates_ = 0;
 }
 
 MediaPlayer::~MediaPlayer()
@@ -69,6 +74,15 @@ void MediaPlayer::accept(Visitor& v) {
     v.visit(*this);
 }
 
+size_t MediaPlayer::total_texture_bytes_ = 0;
+guint64 MediaPlayer::total_frames_uploaded_ = 0;
+std::atomic<guint64> MediaPlayer::total_media_events_(0);
+
+size_t MediaPlayer::textureBytes()
+{
+    return total_texture_bytes_;
+}
+
 guint MediaPlayer::texture() const
 {
     if (textureindex_ == 0)
@@ -215,8 +229,10 @@ void MediaPlayer::close()
     }
 
     // nothing to display
-    glDeleteTextures(1, &textureindex_);
+    GlState::deleteTexture(textureindex_);
     textureindex_ = Resource::getTextureBlack();
+    total_texture_bytes_ -= texturebytes_;
+    texturebytes_ = 0;
 
     // un-ready the media player
     ready_ = false;
@@ -459,37 +475,48 @@ void MediaPlayer::update()
         discoverer_ = nullptr;
     }
 
+    // follow offline mode of all media players
+    bool offline = offline_time_step_ > 0.f;
+    if (offline != offline_)
+        execute_offline(offline);
+    if (offline_ && !isimage_)
+        execute_offline_step( static_cast<GstClockTime>(offline_time_step_ * ABS(rate_) * GST_SECOND) );
+
     // apply texture
     if (v_frame_is_full_) {
         // first occurence; create texture
         if (textureindex_==0) {
-            glActiveTexture(GL_TEXTURE0);
             glGenTextures(1, &textureindex_);
-            glBindTexture(GL_TEXTURE_2D, textureindex_);
+            GlState::bindTexture(0, textureindex_);
             glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_,
                          0, GL_RGBA, GL_UNSIGNED_BYTE, v_frame_.data[0]);
+            texturebytes_ = (size_t) width_ * (size_t) height_ * 4;
+            total_texture_bytes_ += texturebytes_;
         }
         else // bind texture
         {
-            glBindTexture(GL_TEXTURE_2D, textureindex_);
+            GlState::bindTexture(0, textureindex_);
             glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_,
                             GL_RGBA, GL_UNSIGNED_BYTE, v_frame_.data[0]);
         }        
 
+        total_frames_uploaded_++;
+        texture_updates_++;
+
         // sync with callback_pull_last_sample_video 
         v_frame_is_full_ = false;
     }
 
-    // manage loop mode
-    if (need_loop_ && !isimage_) {
+    // manage loop mode (offline steps loop by themselves)
+    if (need_loop_ && !isimage_ && !offline_) {
         execute_loop_command();
-        need_loop_ = false;
     }
+    need_loop_ = false;
 
-    // all other updates below are only for playing mode
-    if (desired_state_ != GST_STATE_PLAYING)
+    // all other updates below are only for realtime playing mode
+    if (desired_state_ != GST_STATE_PLAYING || offline_)
         return;
 
     // test segments
@@ -510,6 +537,96 @@ void MediaPlayer::update()
 
 }
 
+float MediaPlayer::offline_time_step_ = 0.f;
+
+void MediaPlayer::setOfflineTimeStep(float dt)
+{
+    offline_time_step_ = MAXI(dt, 0.f);
+}
+
+void MediaPlayer::execute_offline(bool on)
+{
+    offline_ = on;
+
+    if (pipeline_ == nullptr)
+        return;
+
+    // offline, frames are decoded without synchronization to the clock
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline_), "sink");
+    if (sink) {
+        g_object_set (sink, "sync", on ? FALSE : TRUE, NULL);
+        gst_object_unref (sink);
+    }
+
+    if (on) {
+        // pause and step frame by frame from current frame
+        gst_element_set_state (pipeline_, GST_STATE_PAUSED);
+        gst_element_get_state (pipeline_, NULL, NULL, GST_SECOND);
+        offline_target_ = position_ == GST_CLOCK_TIME_NONE ? 0 : position_;
+    }
+    else
+        // back to realtime
+        gst_element_set_state (pipeline_, desired_state_);
+
+    Log::Info("MediaPlayer %s %s", id_.c_str(), on ? "offline" : "realtime");
+}
+
+void MediaPlayer::pull_offline_frame()
+{
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline_), "sink");
+    if (sink == nullptr)
+        return;
+
+    // frame prerolled in pause
+    GstSample *sample = nullptr;
+    g_object_get (sink, "last-sample", &sample, NULL);
+    if (sample != nullptr) {
+        GstBuffer *buf = gst_buffer_ref ( gst_sample_get_buffer (sample) );
+        fill_v_frame(buf, false);
+        gst_buffer_unref (buf);
+        gst_sample_unref (sample);
+    }
+    gst_object_unref (sink);
+}
+
+void MediaPlayer::execute_offline_step(GstClockTime step)
+{
+    // a paused media does not advance
+    if (pipeline_ == nullptr || desired_state_ != GST_STATE_PLAYING)
+        return;
+
+    offline_target_ += step;
+    GstClockTime half_frame = frame_duration_ == GST_CLOCK_TIME_NONE ? 0 : frame_duration_ / 2;
+
+    // step frame by frame until the frame to display at target time
+    // (forward only: negative play speed is played forward offline)
+    for (int steps = 0; steps < 1000; ++steps) {
+
+        if ( position_ != GST_CLOCK_TIME_NONE && position_ + half_frame >= offline_target_ )
+            break;
+
+        GstClockTime previous = position_;
+        gst_element_send_event (pipeline_, gst_event_new_step (GST_FORMAT_BUFFERS, 1, 1.0, TRUE, FALSE));
+        gst_element_get_state (pipeline_, NULL, NULL, GST_SECOND);
+        pull_offline_frame();
+
+        // no new frame: end of stream
+        if (position_ == previous) {
+            if (loop_ == LOOP_NONE || !seekable_)
+                break;
+            // rewind accurately, and continue from the beginning
+            GstClockTime start = start_position_ == GST_CLOCK_TIME_NONE ? 0 : start_position_;
+            offline_target_ = start + (previous == GST_CLOCK_TIME_NONE ? 0 : offline_target_ - previous);
+            gst_element_seek_simple (pipeline_, GST_FORMAT_TIME,
+                                     (GstSeekFlags) (GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE), 0);
+            gst_element_get_state (pipeline_, NULL, NULL, GST_SECOND);
+            pull_offline_frame();
+            if (position_ == previous)
+                break;
+        }
+    }
+}
+
 void MediaPlayer::execute_loop_command()
 {
     if (loop_==LOOP_REWIND) {
@@ -652,7 +769,8 @@ GstFlowReturn MediaPlayer::callback_pull_sample_video (GstElement *bin, MediaPla
 {
     GstFlowReturn ret = GST_FLOW_OK;
 
-    if (m && !m->v_frame_is_full_) {
+    // offline, frames are pulled in update()
+    if (m && !m->v_frame_is_full_ && !m->offline_) {
 
         // get last sample (non blocking)
         GstSample *sample = nullptr;
@@ -669,6 +787,10 @@ GstFlowReturn MediaPlayer::callback_pull_sample_video (GstElement *bin, MediaPla
                 ret = GST_FLOW_ERROR;
             // free buffer
             gst_buffer_unref (buf);
+
+            // frame to upload: wake up the main loop
+            total_media_events_++;
+            Rendering::manager().WakeUp();
         }
         else
             ret = GST_FLOW_FLUSHING;
@@ -795,6 +917,9 @@ void MediaPlayer::callback_discoverer_finished(GstDiscoverer *discoverer, MediaP
             m->discoverer_message_.clear();
             m->failed_ = true;
         }
+        // media opened (or failed): wake up the main loop
+        total_media_events_++;
+        Rendering::manager().WakeUp();
     }
 }
 
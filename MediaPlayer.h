@@ -199,6 +199,31 @@ public:
      * Must be called in OpenGL context
      * */
     guint texture() const;
+    /**
+     * Get the GPU memory used by textures of all media players
+     * */
+    static size_t textureBytes();
+    /**
+     * Offline mode of all media players (e.g. for export) if dt > 0
+     * Frames are decoded one by one without clock, and each update()
+     * advances the media by dt seconds (at play speed).
+     * Realtime playback if dt is 0
+     * */
+    static void setOfflineTimeStep(float dt);
+    static inline float offlineTimeStep() { return offline_time_step_; }
+    /**
+     * Number of frames uploaded by all media players (e.g. to detect activity)
+     * */
+    static inline guint64 framesUploaded() { return total_frames_uploaded_; }
+    /**
+     * Number of frames uploaded into the texture of this media player
+     * */
+    inline guint64 textureUpdates() const { return texture_updates_; }
+    /**
+     * Number of frames and discoveries received from gstreamer threads
+     * (each wakes up the main loop if waiting for events)
+     * */
+    static inline guint64 mediaEvents() { return total_media_events_; }
     /**
      * Get Image properties
      * */
@@ -222,6 +247,11 @@ private:
     std::string id_;
     std::string uri_;
     guint textureindex_;
+    size_t texturebytes_;
+    static size_t total_texture_bytes_;
+    static guint64 total_frames_uploaded_;
+    guint64 texture_updates_;
+    static std::atomic<guint64> total_media_events_;
     guint width_;
     guint height_;
     guint par_width_;  // width to match pixel aspect ratio
@@ -242,6 +272,9 @@ private:
     GstVideoInfo v_frame_video_info_;
     std::atomic<bool> v_frame_is_full_;
     std::atomic<bool> need_loop_;
+    std::atomic<bool> offline_;
+    GstClockTime offline_target_;
+    static float offline_time_step_;
 
     MediaSegmentSet segments_;
     MediaSegmentSet::iterator current_segment_;
@@ -255,6 +288,9 @@ private:
     void execute_open();
     void execute_loop_command();
     void execute_seek_command(GstClockTime target = GST_CLOCK_TIME_NONE);   
+    void execute_offline(bool on);
+    void execute_offline_step(GstClockTime step);
+    void pull_offline_frame();
     bool fill_v_frame(GstBuffer *buf, bool ignorepts = false);
 
     static GstFlowReturn callback_pull_sample_video (GstElement *bin, MediaPlayer *m);
@@ -11,7 +11,7 @@
 #include "Visitor.h"
 #include "Log.h"
 
-MediaSource::MediaSource() : Source(), path_("")
+MediaSource::MediaSource() : Source(), path_(""), texture_updates_(0)
 {
     // create media player
     mediaplayer_ = new MediaPlayer;
@@ -60,6 +60,14 @@ uint MediaSource::texture() const
     return mediaplayer_->texture();
 }
 
+size_t MediaSource::gpuBytes() const
+{
+    size_t bytes = Source::gpuBytes();
+    if (mediaplayer_->texture() != Resource::getTextureBlack())
+        bytes += (size_t) mediaplayer_->width() * (size_t) mediaplayer_->height() * 4;
+    return bytes;
+}
+
 void MediaSource::init()
 {
     if ( mediaplayer_->isOpen() ) {
@@ -101,11 +109,9 @@ void MediaSource::render()
         // update video
         mediaplayer_->update();
 
-        // render the media player into frame buffer
-        static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -1.f, 1.f);
-        renderbuffer_->begin();
-        mediasurface_->draw(glm::identity<glm::mat4>(), projection);
-        renderbuffer_->end();
+        // render the media player into frame buffer (if new frame)
+        renderSurface(mediasurface_, mediaplayer_->textureUpdates() != texture_updates_);
+        texture_updates_ = mediaplayer_->textureUpdates();
     }
 }
 
@@ -13,6 +13,7 @@ public:
     void render() override;
     bool failed() const override;
     uint texture() const override;
+    size_t gpuBytes() const override;
     void accept (Visitor& v) override;
 
     // Media specific interface
@@ -27,6 +28,7 @@ protected:
     Surface *mediasurface_;
     std::string path_;
     MediaPlayer *mediaplayer_;
+    uint64_t texture_updates_;
 };
 
 #endif // MEDIASOURCE_H
@@ -5,11 +5,15 @@
 #include <vector>
 #include <map>
 #include <utility>
+#include <mutex>
+#include <chrono>
+#include <cstring>
 
 #include <glad/glad.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/vector_angle.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include "RenderingManager.h"
 #include "Primitives.h"
@@ -19,330 +23,209 @@
 #include "Log.h"
 #include "Mesh.h"
 #include "GlmToolkit.h"
+#include "GlState.h"
+#include "PlyParser.h"
+#include "MeshFile.h"
 
 using namespace std;
 using namespace glm;
 
 
+// Content of a PLY file, shared by all the meshes created from it
+struct MeshData
+{
+    // parsed PLY file
+    std::vector<glm::vec3> points;
+    std::vector<glm::vec4> colors;
+    std::vector<glm::vec2> texCoords;
+    std::vector<uint>      indices;
+    uint drawMode;
+    GlmToolkit::AxisAlignedBoundingBox bbox;
+
+    // or binary mesh in resources
+    bool binary;
+    MeshFileHeader header;
+    const char *vertices;
+    const char *elements;
+
+    // vertex array created by the first mesh initialized
+    uint vao;
+    uint drawCount;
+    uint indexType;
+    size_t bytes;
+
+    uint references;
+
+    MeshData() : drawMode(0), binary(false), vertices(nullptr), elements(nullptr),
+        vao(0), drawCount(0), indexType(0), bytes(0), references(0) {}
+};
+
+// Meshes can be created in any thread (e.g. loading a session),
+// but vertex arrays are created and deleted in the rendering thread
+static std::map<std::string, MeshData *> meshCache;
+static std::mutex meshCacheAccess;
+static uint meshInstances = 0;
+static double meshLoadingTime = 0.0;
+
+// binary mesh converted at build time from a PLY file of the resources
+static bool loadMeshFile(const std::string& mesh_path, MeshData *data)
+{
+    if ( !Resource::hasFile(mesh_path) )
+        return false;
 
-typedef std::vector< std::pair< std::string, int> > plyElement;
+    size_t size = 0;
+    const char *buffer = Resource::getData(mesh_path, &size);
+    if ( !buffer || size < sizeof(MeshFileHeader) )
+        return false;
 
-typedef struct prop {
-    std::string name;
-    bool is_float;
-    bool is_list;
-    prop(std::string n, bool t, bool l = false){
-        name = n;
-        is_float = t;
-        is_list = l;
+    // header is copied (resource data is not aligned)
+    MeshFileHeader &h = data->header;
+    memcpy(&h, buffer, sizeof(MeshFileHeader));
+    size_t verticesSize = (size_t) h.vertexCount * h.vertexStride;
+    size_t elementsSize = (size_t) h.indexCount * h.indexSize;
+    if ( h.magic != MESHFILE_MAGIC || h.version != MESHFILE_VERSION ||
+         size != sizeof(MeshFileHeader) + verticesSize + elementsSize ) {
+        Log::Warning("Invalid binary mesh %s", mesh_path.c_str());
+        return false;
     }
-} plyProperty;
-
-typedef std::map<std::string, std::vector<plyProperty> > plyElementProperties;
 
-//float parseValue()
-template <typename T>
-T parseValue(std::istream& istream) {
-
-    T v;
-    char space = ' ';
-    istream >> v;
-    if (!istream.eof()) {
-        istream >> space >> std::ws;
-    }
+    data->binary = true;
+    data->drawMode = h.drawMode;
+    data->vertices = buffer + sizeof(MeshFileHeader);
+    data->elements = data->vertices + verticesSize;
+    data->bbox.extend( glm::make_vec3(h.bboxMin) );
+    data->bbox.extend( glm::make_vec3(h.bboxMax) );
 
-    return v;
+    return true;
 }
 
-/**
- * @brief parsePLY
- *
- * Loosely inspired from libply
- * https://web.archive.org/web/20151202190005/http://people.cs.kuleuven.be/~ares.lagae/libply/
- *
- * @param ascii content of an ascii PLY file
- * @param outPositions vertices
- * @param outColors colors
- * @param outUV texture coordinates
- * @param outIndices indices of faces
- * @param outPrimitive type of faces (triangles, etc.)
- * @return true on success read
- */
-bool parsePLY(string ascii,
-              vector<vec3> &outPositions,
-              vector<vec4> &outColors,
-              vector<vec2> &outUV,
-              vector<uint> &outIndices,
-              uint &outPrimitive)
+// upload the interleaved vertices and the indices of a binary mesh
+static uint createVertexArray(const MeshData *data)
 {
-    stringstream istream(ascii);
-
-    std::string line;
-    std::size_t line_number_ = 0;
-
-    // magic
-    char magic[3];
-    istream.read(magic, 3);
-    istream.ignore(1);
-    ++line_number_;
-    if (!istream) {
-        Log::Warning("Parse error line %d: not ASCII?", line_number_);
-        return false;
-    }
-    if ((magic[0] != 'p') || (magic[1] != 'l') || (magic[2] != 'y')){
-        Log::Warning("Parse error line %d: not PLY format", line_number_);
-        return false;
+    const MeshFileHeader &h = data->header;
+
+    uint vao = 0;
+    uint buffers[2];
+    glGenVertexArrays( 1, &vao );
+    glGenBuffers( 2, buffers );
+    glBindVertexArray( vao );
+
+    glBindBuffer( GL_ARRAY_BUFFER, buffers[0] );
+    glBufferData( GL_ARRAY_BUFFER, (size_t) h.vertexCount * h.vertexStride, data->vertices, GL_STATIC_DRAW );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, buffers[1] );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, (size_t) h.indexCount * h.indexSize, data->elements, GL_STATIC_DRAW );
+
+    // attributes 0, 1 and 2 (point, color and texcoord) are interleaved
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, h.vertexStride, (void *)0 );
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, h.vertexStride, (void *)(sizeof(glm::vec3)) );
+    glEnableVertexAttribArray(1);
+    if ( h.hasTexCoords ) {
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, h.vertexStride, (void *)(sizeof(glm::vec3) + sizeof(glm::vec4)) );
+        glEnableVertexAttribArray(2);
     }
 
-    plyElement elements;
-    plyElementProperties elementsProperties;
-    std::string current_element = "";
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 
-    // parse header
-    while (std::getline(istream, line)) {
-
-        ++line_number_;
-        std::istringstream stringstream(line);
-        stringstream.unsetf(std::ios_base::skipws);
-
-        stringstream >> std::ws;
-        if (stringstream.eof()) {
-            Log::Warning("Ignoring line %d: '%s'", line_number_, line.c_str());
-        }
+    // buffers are kept by the vertex array
+    glDeleteBuffers( 2, buffers );
 
-        else {
-            std::string keyword;
-            stringstream >> keyword;
-
-            // format
-            if (keyword == "format") {
-                std::string format_string, version;
-                char space_format_format_string, space_format_string_version;
-                stringstream >> space_format_format_string >> std::ws >> format_string >> space_format_string_version >> std::ws >> version >> std::ws;
-                if (!stringstream.eof() ||
-                        !std::isspace(space_format_format_string) ||
-                        !std::isspace(space_format_string_version)) {
-                    Log::Warning("Parse error line %d: '%s'", line_number_, line.c_str());
-                    return false;
-                }
-                if (format_string != "ascii") {
-                    Log::Warning("Not PLY file format %s", format_string.c_str());
-                }
-                if (version != "1.0") {
-                    Log::Warning("Unsupported PLY version %s", version.c_str());
-                    return false;
-                }
-            }
-
-            // element
-            else if (keyword == "element") {
-                std::string name;
-                std::size_t count;
-                char space_element_name, space_name_count;
-                stringstream >> space_element_name >> std::ws >> name >> space_name_count >> std::ws >> count >> std::ws;
-                if (!stringstream.eof() ||
-                        !std::isspace(space_element_name) ||
-                        !std::isspace(space_name_count)) {
-                    Log::Warning("Parse error line %d: '%s'", line_number_, line.c_str());
-                    return false;
-                }
-                current_element = name;
-                elements.push_back( pair<string, int>{current_element, count} );
-            }
-
-            // property
-            else if (keyword == "property") {
-                std::string type_or_list;
-                char space_property_type_or_list;
-                stringstream >> space_property_type_or_list >> std::ws >> type_or_list;
-                if (!std::isspace(space_property_type_or_list)) {
-                    Log::Warning("Parse error line %d: '%s'", line_number_, line.c_str());
-                  return false;
-                }
-
-                // NOT A LIST property : i.e. a type & a name (e.g. 'property float x' )
-                if (type_or_list != "list") {
-                    std::string name;
-                    std::string& type = type_or_list;
-                    char space_type_name;
-                    stringstream >> space_type_name >> std::ws >> name >> std::ws;
-                    if (!std::isspace(space_type_name)) {
-                        Log::Warning("Parse error line %d: '%s'", line_number_, line.c_str());
-                        return false;
-                    }
-                    bool float_value =  ( type == "float" ) | ( type == "double" );
-                    elementsProperties[current_element].push_back(plyProperty(name, float_value));
-                }
-                // list property : several types & a name (e.g. 'property list uchar uint vertex_indices')
-                else {
-                    std::string name;
-                    std::string size_type_string, scalar_type_string;
-                    char space_list_size_type, space_size_type_scalar_type, space_scalar_type_name;
-                    stringstream >> space_list_size_type >> std::ws >> size_type_string >> space_size_type_scalar_type >> std::ws >> scalar_type_string >> space_scalar_type_name >> std::ws >> name >> std::ws;
-                    if (!std::isspace(space_list_size_type) ||
-                            !std::isspace(space_size_type_scalar_type) ||
-                            !std::isspace(space_scalar_type_name)) {
-                      Log::Warning("Parse error line %d: '%s'", line_number_, line.c_str());
-                      return false;
-                    }
-                    elementsProperties[current_element].push_back(plyProperty(name, false, true));
-                }
-
-            }
+    return vao;
+}
 
-            // end_header
-            else if (keyword == "end_header") {
-                break;
-            }
-        }
-    } // end while readline header
+static MeshData *acquireMeshData(const std::string& ply_path)
+{
+    std::lock_guard<std::mutex> lock(meshCacheAccess);
 
-    uint num_vertex_per_face = 0;
-    // loop over elements
-    for (uint i=0; i< elements.size(); ++i)
-    {
-        std::string elem = elements[i].first;
-        int num_data = elements[i].second;
+    MeshData *data = nullptr;
+    auto it = meshCache.find(ply_path);
+    if ( it != meshCache.end() )
+        data = it->second;
+    else {
+        auto start = std::chrono::steady_clock::now();
 
-        // loop over lines of properties of the element
-        for (int n = 0; n < num_data; ++n )
+        // use the binary mesh if converted at build time, or parse PLY file
+        data = new MeshData;
+        std::string mesh_path = ply_path.substr(0, ply_path.find_last_of('.')) + MESHFILE_EXTENSION;
+        if ( !loadMeshFile(mesh_path, data) &&
+             !parsePLY( Resource::getText(ply_path), data->points, data->colors, data->texCoords, data->indices, data->drawMode) )
         {
-            if (!std::getline(istream, line)) {
-                Log::Warning("Parse error line %d: '%s'", line_number_, line.c_str());
-                return false;
-            }
-            ++line_number_;
-            std::istringstream stringstream(line);
-            stringstream.unsetf(std::ios_base::skipws);
-            stringstream >> std::ws;
-
-            vec3 point = vec3(0.f, 0.f, 0.f);
-            vec4 color = vec4(1.f, 1.f, 1.f, 1.f);
-            vec2 uv = vec2(0.f, 0.f);
-            bool has_point = false;
-            bool has_uv = false;
-
-            // read each property of the element
-            for (uint j = 0; j < elementsProperties[elem].size(); ++j)
-            {
-                plyProperty prop = elementsProperties[elem][j];
-
-                // a numerical property
-                if ( ! prop.is_list ) {
-
-                    float value;
-                    switch ( prop.name[0] ) {
-                    case 'x':
-                        point.x = parseValue<float>(stringstream);
-                        has_point = true;
-                        break;
-                    case 'y':
-                        point.y = parseValue<float>(stringstream);
-                        has_point = true;
-                        break;
-                    case 'z':
-                        point.z = parseValue<float>(stringstream);
-                        has_point = true;
-                        break;
-                    case 's':
-                        uv.x = parseValue<float>(stringstream);
-                        has_uv = true;
-                        break;
-                    case 't':
-                        uv.y = -parseValue<float>(stringstream);
-                        has_uv = true;
-                        break;
-                    case 'r':
-                        color.r = (float) parseValue<int>(stringstream) / 255.f;
-                        break;
-                    case 'g':
-                        color.g = (float) parseValue<int>(stringstream) / 255.f;
-                        break;
-                    case 'b':
-                        color.b = (float) parseValue<int>(stringstream) / 255.f;
-                        break;
-                    case 'a':
-                        color.a = (float) parseValue<int>(stringstream) / 255.f;
-                        break;
-                    default:
-                        // ignore normals or other types
-                        value = parseValue<float>(stringstream);
-                        break;
-                    }
-                }
-                // a list property
-                else {
-                    // how many values in the list of index ?
-                    uint num_index = parseValue<int>(stringstream);
-
-                    // check that the number of vertex per face is consistent
-                    if (num_vertex_per_face == 0)
-                        num_vertex_per_face = num_index;
-                    else {
-                        if (num_vertex_per_face != num_index) {
-                            Log::Warning("Variable number of vertices per face not supported");
-                            return false;
-                        }
-                    }
-
-                    // safely append those indices
-                    for (uint k = 0; k < num_vertex_per_face; ++k ){
-                        uint index = parseValue<int>(stringstream);
-                        outIndices.push_back( index );
-                    }
-                }
-            }
-
-            // ok, we filled some values
-            if (has_point) {
-                outPositions.push_back(point);
-                outColors.push_back(color);
-                if (has_uv)
-                    outUV.push_back(uv);
-            }
+            data->points.clear();
+            data->colors.clear();
+            data->texCoords.clear();
+            data->indices.clear();
+            Log::Warning("Mesh could not be created from %s", ply_path.c_str());
         }
+        meshCache[ply_path] = data;
 
+        meshLoadingTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
     }
 
-    switch (num_vertex_per_face) {
-    case 1:
-        outPrimitive = GL_POINTS;
-        break;
-    case 2:
-        outPrimitive = GL_LINES;
-        break;
-    case 3:
-        outPrimitive = GL_TRIANGLES;
-        break;
-    case 4:
-        outPrimitive = GL_QUADS;
-        break;
-    default:
-        Log::Warning("Invalid number of vertices per face. Please triangulate your mesh.");
-        return false;
-        break;
+    data->references++;
+    meshInstances++;
+    return data;
+}
+
+static void releaseMeshData(const std::string& ply_path)
+{
+    std::lock_guard<std::mutex> lock(meshCacheAccess);
+
+    auto it = meshCache.find(ply_path);
+    if ( it == meshCache.end() )
+        return;
+
+    MeshData *data = it->second;
+    meshInstances--;
+    if ( --data->references < 1 ) {
+        if ( data->vao ) {
+            glDeleteVertexArrays ( 1, &data->vao);
+            Primitive::releaseVertexBytes(data->bytes);
+        }
+        delete data;
+        meshCache.erase(it);
     }
+}
 
-    return true;
+uint Mesh::instances()
+{
+    std::lock_guard<std::mutex> lock(meshCacheAccess);
+    return meshInstances;
 }
 
+double Mesh::loadingTime()
+{
+    std::lock_guard<std::mutex> lock(meshCacheAccess);
+    return meshLoadingTime;
+}
 
+uint Mesh::vertexArrays()
+{
+    std::lock_guard<std::mutex> lock(meshCacheAccess);
+    uint count = 0;
+    for (auto it = meshCache.begin(); it != meshCache.end(); it++) {
+        if (it->second->vao)
+            count++;
+    }
+    return count;
+}
 
 Mesh::Mesh(const std::string& ply_path, const std::string& tex_path) : Primitive(), mesh_resource_(ply_path), texture_resource_(tex_path), textureindex_(0)
 {
-    if ( !parsePLY( Resource::getText(mesh_resource_), points_, colors_, texCoords_, indices_, drawMode_) )
-    {
-        points_.clear();
-        colors_.clear();
-        texCoords_.clear();
-        indices_.clear();
-        Log::Warning("Mesh could not be created from %s", ply_path.c_str());
-    }
+    data_ = acquireMeshData(mesh_resource_);
+    drawMode_ = data_->drawMode;
 
     // default non texture shader (deleted in Primitive)
     shader_ = new Shader;
 }
 
+Mesh::~Mesh()
+{
+    // vertex array is owned by the shared mesh data, not by Primitive
+    vao_ = 0;
+    releaseMeshData(mesh_resource_);
+}
+
 
 void Mesh::setTexture(uint textureindex)
 {
@@ -356,7 +239,53 @@ void Mesh::setTexture(uint textureindex)
 
 void Mesh::init()
 {
-    Primitive::init();
+    std::unique_lock<std::mutex> lock(meshCacheAccess);
+
+    if ( data_->vao ) {
+        // use the vertex array of an identical mesh
+        vao_ = data_->vao;
+        drawCount_ = data_->drawCount;
+        indexType_ = data_->indexType;
+        bbox_ = data_->bbox;
+        Node::init();
+    }
+    else if ( data_->binary ) {
+        // first mesh of this file to be initialized uploads the binary mesh
+        vao_ = createVertexArray(data_);
+        drawCount_ = data_->header.indexCount;
+        indexType_ = data_->header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        bbox_ = data_->bbox;
+        Node::init();
+
+        data_->vao = vao_;
+        data_->drawCount = drawCount_;
+        data_->indexType = indexType_;
+        data_->bytes = (size_t) data_->header.vertexCount * data_->header.vertexStride
+                     + (size_t) data_->header.indexCount * data_->header.indexSize;
+        total_vertex_bytes_ += data_->bytes;
+    }
+    else {
+        // first mesh of this file to be initialized creates the vertex array
+        points_ = data_->points;
+        colors_ = data_->colors;
+        texCoords_ = data_->texCoords;
+        indices_ = data_->indices;
+        Primitive::init();
+
+        data_->vao = vao_;
+        data_->drawCount = drawCount_;
+        data_->indexType = indexType_;
+        data_->bbox = bbox_;
+        data_->bytes = vertex_bytes_;
+        vertex_bytes_ = 0;
+
+        // vertices are in the vertex array
+        data_->points.clear();
+        data_->colors.clear();
+        data_->texCoords.clear();
+        data_->indices.clear();
+    }
+    lock.unlock();
 
     if (!texture_resource_.empty())
         setTexture(Resource::getTextureImage(texture_resource_));
@@ -370,11 +299,9 @@ void Mesh::draw(glm::mat4 modelview, glm::mat4 projection)
 
     if ( visible_ ) {
         if (textureindex_)
-            glBindTexture(GL_TEXTURE_2D, textureindex_);
+            GlState::bindTexture(0, textureindex_);
 
         Primitive::draw(modelview, projection);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 }
 
@@ -6,17 +6,23 @@
 
 #include "Scene.h"
 
+struct MeshData;
+
 /**
  * @brief The Mesh class creates a Primitive node from a PLY File
  *
  *  PLY - Polygon File Format
  *  Also known as the Stanford Triangle Format
  *  http://paulbourke.net/dataformats/ply/
+ *
+ *  A PLY file is parsed once, and meshes of the same file share
+ *  the same vertex array (reference counted).
  */
 class Mesh : public Primitive {
 
 public:
     Mesh(const std::string& ply_path, const std::string& tex_path = "");
+    ~Mesh();
 
     void setTexture(uint textureindex);
 
@@ -27,10 +33,17 @@ public:
     inline std::string meshPath() const { return mesh_resource_; }
     inline std::string texturePath() const { return texture_resource_; }
 
+    // number of meshes and of vertex arrays they share
+    static uint instances();
+    static uint vertexArrays();
+    // time spent loading mesh files (in milliseconds)
+    static double loadingTime();
+
 protected:
     std::string mesh_resource_;
     std::string texture_resource_;
     uint textureindex_;
+    MeshData *data_;
 
 };
 
@@ -0,0 +1,36 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <cstdint>
+
+/**
+ * Binary mesh format
+ *
+ * PLY files of the resources are converted at build time
+ * (tools/meshconvert.cpp) into files with the same name and
+ * the extension .mesh, which are uploaded as is at runtime:
+ *
+ *  - MeshFileHeader
+ *  - vertexCount interleaved vertices (vertexStride bytes each):
+ *    position (3 floats), color (4 floats), [texture coordinates (2 floats)]
+ *  - indexCount indices (indexSize bytes each, 2 or 4)
+ */
+#define MESHFILE_MAGIC   0x48534d56  // "VMSH"
+#define MESHFILE_VERSION 1
+#define MESHFILE_EXTENSION ".mesh"
+
+struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t drawMode;
+    uint32_t vertexCount;
+    uint32_t vertexStride;
+    uint32_t hasTexCoords;
+    uint32_t indexCount;
+    uint32_t indexSize;
+    float    bboxMin[3];
+    float    bboxMax[3];
+};
+
+#endif // MESHFILE_H
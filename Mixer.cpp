@@ -1,8 +1,7 @@
 #include <algorithm>
-#include <thread>
 #include <atomic>
 #include <vector>
-#include <chrono>
+#include <memory>
 
 #include <tinyxml2.h>
 #include "tinyxml2Toolkit.h"
@@ -18,74 +17,35 @@ using namespace tinyxml2;
 #include "SessionCreator.h"
 #include "SessionSource.h"
 #include "MediaSource.h"
+#include "ImageProcessingShader.h"
+#include "TaskScheduler.h"
+#include "FrameBuffer.h"
+#include "Recorder.h"
+#include "SharedMemoryOutput.h"
 
 #include "Mixer.h"
 
-// static semaphore to prevent multiple threads for load / save
-static std::atomic<bool> sessionThreadActive_ = false;
+// request to swap front and back sessions at next update
 static std::atomic<bool> sessionSwapRequested_ = false;
 
-// static multithreaded session loading
-static void loadSession(const std::string& filename, Session *session)
+// loading of a session file into the given session (in a task thread)
+static bool loadSession(const std::string& filename, Session *session)
 {
-    while (sessionThreadActive_)
-        std::this_thread::sleep_for( std::chrono::milliseconds(50));
-    sessionThreadActive_ = true;
-
     // actual loading of xml file
     SessionCreator creator( session );
 
     if (creator.load(filename)) {
         // loaded ok
         session->setFilename(filename);
-        sessionSwapRequested_ = true;
-
-        // cosmetics load ok
-        Log::Notify("Session %s loaded. %d source(s) created.", filename.c_str(), session->numSource());
-    }
-    else {
-        // error loading
-        Log::Warning("Failed to load Session file %s.", filename.c_str());
+        return true;
     }
 
-    sessionThreadActive_ = false;
+    return false;
 }
 
-static std::atomic<bool> sessionImportRequested_ = false;
-static void importSession(const std::string& filename, Session *session)
+// fill the XML document of a session (in main thread)
+static void saveSession(XMLDocument &xmlDoc, Session *session)
 {
-    while (sessionThreadActive_)
-        std::this_thread::sleep_for( std::chrono::milliseconds(50));
-    sessionThreadActive_ = true;
-
-    // actual loading of xml file
-    SessionCreator creator( session );
-
-    if (creator.load(filename)) {
-        // cosmetics load ok
-        sessionImportRequested_ = true;
-
-        Log::Notify("Session %s loaded. %d source(s) imported.", filename.c_str(), session->numSource());
-    }
-    else {
-        // error loading
-        Log::Warning("Failed to import Session file %s.", filename.c_str());
-    }
-
-    sessionThreadActive_ = false;
-}
-
-// static multithreaded session saving
-static void saveSession(const std::string& filename, Session *session)
-{
-    // reset
-    while (sessionThreadActive_)
-        std::this_thread::sleep_for( std::chrono::milliseconds(50));
-    sessionThreadActive_ = true;
-
-    // creation of XML doc
-    XMLDocument xmlDoc;
-
     XMLElement *version = xmlDoc.NewElement(APP_NAME);
     version->SetAttribute("major", XML_VERSION_MAJOR);
     version->SetAttribute("minor", XML_VERSION_MINOR);
@@ -122,24 +82,10 @@ static void saveSession(const std::string& filename, Session *session)
         render->InsertEndChild( SessionVisitor::NodeToXML(*session->config(View::RENDERING), &xmlDoc));
         views->InsertEndChild(render);
     }
-
-    // save file to disk
-    if ( XMLSaveDoc(&xmlDoc, filename) ) {
-        // all ok
-        session->setFilename(filename);
-        // cosmetics saved ok
-        Settings::application.recentSessions.push(filename);
-        Log::Notify("Session %s saved.", filename.c_str());
-    }
-    else {
-        // error loading
-        Log::Warning("Failed to save Session file %s.", filename.c_str());
-    }
-
-    sessionThreadActive_ = false;
 }
 
-Mixer::Mixer() : session_(nullptr), back_session_(nullptr), current_view_(nullptr)
+Mixer::Mixer() : session_(nullptr), back_session_(nullptr), current_view_(nullptr), update_duration_(0.f),
+    recorder_(nullptr), shared_output_(nullptr)
 {
     // unsused initial empty session
     session_ = new Session;
@@ -158,9 +104,30 @@ Mixer::Mixer() : session_(nullptr), back_session_(nullptr), current_view_(nullpt
     setCurrentView( (View::Mode) Settings::application.current_view );
 }
 
-void Mixer::update()
+void Mixer::post(std::function<void()> command)
+{
+    std::lock_guard<std::mutex> lock(commands_mutex_);
+    commands_.push_back(command);
+}
+
+bool Mixer::busy()
 {
-    // change session when threaded loading is finished
+    std::lock_guard<std::mutex> lock(commands_mutex_);
+    return !commands_.empty() || sessionSwapRequested_ || recorder_ != nullptr || shared_output_ != nullptr;
+}
+
+void Mixer::apply()
+{
+    // apply edits posted since previous frame
+    std::list< std::function<void()> > commands;
+    {
+        std::lock_guard<std::mutex> lock(commands_mutex_);
+        commands.swap(commands_);
+    }
+    for (auto it = commands.begin(); it != commands.end(); ++it)
+        (*it)();
+
+    // change session when requested
     if (sessionSwapRequested_) {
         sessionSwapRequested_ = false;
         // successfully loading
@@ -172,23 +139,30 @@ void Mixer::update()
             Settings::application.recentSessions.push(session_->filename());
         }
     }
+}
 
-    if (sessionImportRequested_) {
-        sessionImportRequested_ = false;
-        merge(back_session_);
-        back_session_ = nullptr;
-    }
+void Mixer::update(float dt)
+{
+    // apply edits and change of session
+    apply();
 
     // compute dt
     if (update_time_ == GST_CLOCK_TIME_NONE)
         update_time_ = gst_util_get_timestamp ();
     gint64 current_time = gst_util_get_timestamp ();
-    float dt = static_cast<float>( GST_TIME_AS_MSECONDS(current_time - update_time_) ) * 0.001f;
+    if (dt < 0.f)
+        dt = static_cast<float>( GST_TIME_AS_MSECONDS(current_time - update_time_) ) * 0.001f;
     update_time_ = current_time;
 
     // update session and associated sources
     session_->update(dt);
 
+    // record the frame of the session
+    if (recorder_)
+        recorder_->addFrame( session_->frame() );
+    if (shared_output_)
+        shared_output_->addFrame( session_->frame() );
+
     if (session()->failedSource() != nullptr)
         deleteSource(session()->failedSource());
 
@@ -200,6 +174,9 @@ void Mixer::update()
     // optimize the reordering in depth for views
     // deep updates shall be performed only 1 frame
     View::need_deep_update_ = false;
+
+    // measure duration of update (session and views)
+    update_duration_ = static_cast<float>( gst_util_get_timestamp () - current_time ) * 0.000001f;
 }
 
 void Mixer::draw()
@@ -467,32 +444,76 @@ void Mixer::saveas(const std::string& filename)
     session_->config(View::GEOMETRY)->copyTransform( geometry_.scene.root() );
     session_->config(View::LAYER)->copyTransform( layer_.scene.root() );
 
-    // launch a thread to save the session
-    std::thread (saveSession, filename, session_).detach();
+    // create the XML document here, as the session can change after
+    std::shared_ptr<XMLDocument> xmlDoc = std::make_shared<XMLDocument>();
+    saveSession(*xmlDoc, session_);
+
+    // write file to disk in a task, and inform when done
+    Session *session = session_;
+    TaskScheduler::manager().async<bool>("Save " + filename,
+        [=]() { return XMLSaveDoc(xmlDoc.get(), filename); },
+        [=](std::shared_future<bool> saved) {
+            if ( saved.get() ) {
+                // all ok
+                if (session_ == session)
+                    session_->setFilename(filename);
+                // cosmetics saved ok
+                Settings::application.recentSessions.push(filename);
+                Log::Notify("Session %s saved.", filename.c_str());
+            }
+            else {
+                // error saving
+                Log::Warning("Failed to save Session file %s.", filename.c_str());
+            }
+        }, TaskScheduler::PRIORITY_HIGH);
 }
 
 void Mixer::open(const std::string& filename)
 {
-    if (back_session_)
-        delete back_session_;
-
-    // create empty session
-    back_session_ = new Session;
-
-    // launch a thread to load the session into back_session
-    std::thread (loadSession, filename, back_session_).detach();
+    // cancel previous opening if not finished: the last one wins
+    session_loading_.cancel();
+    session_loading_ = TaskScheduler::Cancellation();
+
+    // load the session in a task, into a new session
+    Session *session = new Session;
+    TaskScheduler::Cancellation token = session_loading_;
+    TaskScheduler::manager().async<bool>("Open " + filename,
+        [=]() { return loadSession(filename, session); },
+        [=](std::shared_future<bool> loaded) {
+            if ( !token.cancelled() && loaded.get() ) {
+                // set as back session and swap front and back sessions
+                if (back_session_)
+                    delete back_session_;
+                back_session_ = session;
+                sessionSwapRequested_ = true;
+                // cosmetics load ok
+                Log::Notify("Session %s loaded. %d source(s) created.", filename.c_str(), session->numSource());
+            }
+            else {
+                if (!token.cancelled())
+                    Log::Warning("Failed to load Session file %s.", filename.c_str());
+                delete session;
+            }
+        }, TaskScheduler::PRIORITY_NORMAL, token);
 }
 
 void Mixer::import(const std::string& filename)
 {
-    if (back_session_)
-        delete back_session_;
-
-    // create empty session
-    back_session_ = new Session;
-
-    // launch a thread to load the session into back_session
-    std::thread (importSession, filename, back_session_).detach();
+    // load the session in a task, into a new session
+    Session *session = new Session;
+    TaskScheduler::manager().async<bool>("Import " + filename,
+        [=]() { return loadSession(filename, session); },
+        [=](std::shared_future<bool> loaded) {
+            if ( loaded.get() ) {
+                Log::Notify("Session %s loaded. %d source(s) imported.", filename.c_str(), session->numSource());
+                // merge sources in current session (deletes session)
+                merge(session);
+            }
+            else {
+                Log::Warning("Failed to import Session file %s.", filename.c_str());
+                delete session;
+            }
+        });
 }
 
 void Mixer::merge(Session *session)
@@ -527,13 +548,18 @@ void Mixer::swap()
     back_session_ = tmp;
 
     // attach new session's nodes to views
+    std::list<ImageProcessingShader *> shaders;
     for (auto source_iter = session_->begin(); source_iter != session_->end(); source_iter++)
     {
         mixing_.scene.ws()->attach( (*source_iter)->group(View::MIXING) );
         geometry_.scene.ws()->attach( (*source_iter)->group(View::GEOMETRY) );
         layer_.scene.ws()->attach( (*source_iter)->group(View::LAYER) );
+        shaders.push_back( (*source_iter)->processingShader() );
     }
 
+    // prepare the shader variants used by the sources before their first frame
+    ImageProcessingShader::prewarm(shaders);
+
     // optional copy of views config
     mixing_.scene.root()->copyTransform( session_->config(View::MIXING) );
     geometry_.scene.root()->copyTransform( session_->config(View::GEOMETRY) );
@@ -585,3 +611,54 @@ void Mixer::set(Session *s)
     // swap current with given session
     sessionSwapRequested_ = true;
 }
+
+void Mixer::startRecording()
+{
+    if (recorder_)
+        return;
+
+    std::string path = Settings::application.record.path;
+    if (path.empty())
+        path = SystemToolkit::home_path();
+
+    FrameBuffer *frame = session_->frame();
+    recorder_ = new Recorder(frame->width(), frame->height(), Settings::application.record.profile, path);
+    if (recorder_->failed()) {
+        Log::Warning("Cannot record %s.", recorder_->filename().c_str());
+        stopRecording();
+    }
+}
+
+void Mixer::stopRecording()
+{
+    if (recorder_ == nullptr)
+        return;
+
+    // finishes the file in the background
+    recorder_->stop();
+    delete recorder_;
+    recorder_ = nullptr;
+}
+
+void Mixer::startSharing()
+{
+    if (shared_output_)
+        return;
+
+    FrameBuffer *frame = session_->frame();
+    shared_output_ = new SharedMemoryOutput(frame->width(), frame->height(), Settings::application.shm.socket_path,
+                                            Settings::application.shm.format, Settings::application.shm.resolution);
+    if (shared_output_->failed()) {
+        Log::Warning("Cannot share output to %s.", shared_output_->socketPath().c_str());
+        stopSharing();
+    }
+}
+
+void Mixer::stopSharing()
+{
+    if (shared_output_ == nullptr)
+        return;
+
+    delete shared_output_;
+    shared_output_ = nullptr;
+}
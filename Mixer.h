@@ -2,6 +2,10 @@
 #define MIXER_H
 
 
+#include <functional>
+#include <list>
+#include <mutex>
+
 //  GStreamer
 #include <gst/gst.h>
 
@@ -9,6 +13,10 @@
 #include "View.h"
 #include "Session.h"
 #include "Source.h"
+#include "TaskScheduler.h"
+
+class Recorder;
+class SharedMemoryOutput;
 
 
 class Mixer
@@ -28,11 +36,27 @@ public:
     }
 
     // update session and all views
-    void update();
+    // (dt in seconds is measured if not given, e.g. for fixed time step)
+    void update(float dt = -1.f);
 
     // draw session and current view
     void draw();
 
+    // edit of the session from the user interface, applied between
+    // frames (at the beginning of next update)
+    void post(std::function<void()> command);
+
+    // apply posted edits and swap to the session loaded, if any
+    // (done at the beginning of update)
+    void apply();
+
+    // true if the session changes or outputs need every frame
+    // (other than playing media); false allows idle
+    bool busy();
+
+    // duration of the last update, in milliseconds
+    inline float updateDuration() const { return update_duration_; }
+
     // manangement of sources
     Source * createSourceFile(std::string path);
     Source * createSourceClone(std::string namesource);
@@ -69,10 +93,21 @@ public:
     void merge(Session *s);
     void set(Session *s);
 
+    // record the output of the session (in real time)
+    void startRecording();
+    void stopRecording();
+    inline Recorder *recorder() const { return recorder_; }
+
+    // publish the output of the session in shared memory
+    void startSharing();
+    void stopSharing();
+    inline SharedMemoryOutput *sharedOutput() const { return shared_output_; }
+
 protected:
 
     Session *session_;
     Session *back_session_;
+    TaskScheduler::Cancellation session_loading_;
     void swap();
 
     void setCurrentSource(SourceList::iterator it);
@@ -85,6 +120,13 @@ protected:
     View *current_view_;
 
     gint64 update_time_;
+    float update_duration_;
+
+    std::mutex commands_mutex_;
+    std::list< std::function<void()> > commands_;
+
+    Recorder *recorder_;
+    SharedMemoryOutput *shared_output_;
 
 };
 
@@ -0,0 +1,285 @@
+#include "OutputWindow.h"
+
+#include <chrono>
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_GLEXT
+#include <GLFW/glfw3.h>
+
+#include "defines.h"
+#include "Log.h"
+#include "Settings.h"
+#include "FrameBuffer.h"
+
+OutputWindow::OutputWindow(int index, GLFWwindow *share) : index_(index), window_(nullptr), ring_index_(0),
+    new_frame_(false), running_(true), slot_(-1), reading_(-1), texture_(0), texture_width_(0), texture_height_(0), fence_(nullptr),
+    width_(0), height_(0), swap_interval_(1), frames_(0), swap_duration_(0.f)
+{
+    for (int i = 0; i < OUTPUT_RING_SIZE; ++i) {
+        ring_[i] = nullptr;
+        read_fence_[i] = nullptr;
+    }
+
+    // settings of the window
+    while ( Settings::application.windows.size() <= (size_t) index_ )
+        Settings::application.windows.push_back( Settings::WindowConfig(std::string(APP_NAME " -- Output ") +
+                                                                        std::to_string(Settings::application.windows.size())) );
+    Settings::WindowConfig winset = Settings::application.windows[index_];
+    swap_interval_ = winset.swap_interval;
+
+    // no multisampling: the default frame buffer is the target of a blit
+    glfwWindowHint(GLFW_SAMPLES, 0);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    window_ = glfwCreateWindow(winset.w, winset.h, winset.name.c_str(), NULL, share);
+    if (window_ == NULL){
+        Log::Warning("Failed to Create Output Window %d.", index_);
+        return;
+    }
+    glfwSetWindowUserPointer(window_, this);
+    glfwSetFramebufferSizeCallback(window_, OutputWindow::resizeCallback);
+    glfwSetWindowPos(window_, winset.x, winset.y);
+
+    int w = 0, h = 0;
+    glfwGetFramebufferSize(window_, &w, &h);
+    width_ = w;
+    height_ = h;
+
+    // restore fullscreen
+    if (winset.fullscreen)
+        setMonitor(winset.monitor);
+
+    // the context of the window is current in its thread
+    thread_ = std::thread(&OutputWindow::loop, this);
+}
+
+OutputWindow::~OutputWindow()
+{
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        frame_ready_.notify_all();
+        thread_.join();
+    }
+
+    if (fence_)
+        glDeleteSync( (GLsync) fence_ );
+    for (int i = 0; i < OUTPUT_RING_SIZE; ++i) {
+        if (read_fence_[i])
+            glDeleteSync( (GLsync) read_fence_[i] );
+        if (ring_[i])
+            delete ring_[i];
+    }
+
+    if (window_) {
+        saveSettings();
+        glfwDestroyWindow(window_);
+    }
+}
+
+bool OutputWindow::shouldClose() const
+{
+    return window_ == nullptr || glfwWindowShouldClose(window_);
+}
+
+void OutputWindow::resizeCallback(GLFWwindow *window, int width, int height)
+{
+    OutputWindow *output = static_cast<OutputWindow *>( glfwGetWindowUserPointer(window) );
+    if (output) {
+        output->width_ = width;
+        output->height_ = height;
+    }
+}
+
+void OutputWindow::setFrame(FrameBuffer *frame)
+{
+    if (window_ == nullptr || frame == nullptr)
+        return;
+
+    // next copy, not the one the thread is reading
+    int slot = 0;
+    GLsync read = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot = (ring_index_ + 1) % OUTPUT_RING_SIZE;
+        if (slot == reading_)
+            slot = (slot + 1) % OUTPUT_RING_SIZE;
+        read = (GLsync) read_fence_[slot];
+        read_fence_[slot] = nullptr;
+    }
+    ring_index_ = slot;
+
+    // GPU waits for the end of the last blit of the copy
+    if (read) {
+        glWaitSync(read, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(read);
+    }
+
+    // copy follows the size of the frame
+    FrameBuffer *copy = ring_[slot];
+    if (copy && (copy->width() != frame->width() || copy->height() != frame->height())) {
+        delete copy;
+        copy = nullptr;
+    }
+    if (copy == nullptr) {
+        copy = new FrameBuffer(frame->width(), frame->height());
+        ring_[slot] = copy;
+    }
+    copy->bind();
+    frame->blit(copy);
+
+    // fence after the copy of the frame, for the thread to wait on GPU
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // previous frame not shown yet: replaced
+        if (fence_)
+            glDeleteSync( (GLsync) fence_ );
+        fence_ = fence;
+        slot_ = slot;
+        texture_ = copy->texture();
+        texture_width_ = copy->width();
+        texture_height_ = copy->height();
+        new_frame_ = true;
+    }
+    frame_ready_.notify_one();
+}
+
+void OutputWindow::loop()
+{
+    glfwMakeContextCurrent(window_);
+    int interval = swap_interval_;
+    glfwSwapInterval(interval);
+
+    // frame buffer object to read the texture (not shared between contexts)
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+
+    while (true) {
+
+        // wait for a frame
+        GLuint texture = 0;
+        int tw = 0, th = 0;
+        int slot = -1;
+        GLsync fence = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frame_ready_.wait(lock, [this]{ return new_frame_ || !running_; });
+            if (!running_)
+                break;
+            new_frame_ = false;
+            slot = slot_;
+            reading_ = slot;
+            texture = texture_;
+            tw = texture_width_;
+            th = texture_height_;
+            fence = (GLsync) fence_;
+            fence_ = nullptr;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (interval != swap_interval_) {
+            interval = swap_interval_;
+            glfwSwapInterval(interval);
+        }
+
+        // GPU waits for the frame to be rendered
+        if (fence) {
+            glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+        }
+
+        // attach the copy (texture names are recycled by the pool)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glClearColor(0.f, 0.f, 0.f, 1.f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // letterbox the frame in the window
+        int w = width_, h = height_;
+        if (tw > 0 && th > 0 && w > 0 && h > 0) {
+            float scale = MINI( float(w) / float(tw), float(h) / float(th) );
+            int bw = int(float(tw) * scale);
+            int bh = int(float(th) * scale);
+            int x = (w - bw) / 2;
+            int y = (h - bh) / 2;
+            // the copy is upside down (FrameBuffer::blit flips vertically)
+            glBlitFramebuffer(0, th, tw, 0, x, y, x + bw, y + bh, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+
+        // fence after the blit, for the main thread to wait on before next copy
+        GLsync read = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (read_fence_[slot])
+                glDeleteSync( (GLsync) read_fence_[slot] );
+            read_fence_[slot] = read;
+            reading_ = -1;
+        }
+
+        glfwSwapBuffers(window_);
+
+        // statistics
+        float d = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        swap_duration_ = frames_ > 0 ? 0.9f * swap_duration_ + 0.1f * d : d;
+        frames_++;
+    }
+
+    glDeleteFramebuffers(1, &fbo);
+    glfwMakeContextCurrent(NULL);
+}
+
+void OutputWindow::setMonitor(int monitor)
+{
+    if (window_ == nullptr)
+        return;
+
+    Settings::WindowConfig &winset = Settings::application.windows[index_];
+
+    // back to window mode
+    if (monitor < 0) {
+        glfwSetWindowMonitor( window_, nullptr, winset.x, winset.y, winset.w, winset.h, 0 );
+        winset.fullscreen = false;
+        return;
+    }
+
+    int count = 0;
+    GLFWmonitor **monitors = glfwGetMonitors(&count);
+    if (count < 1)
+        return;
+
+    // remember window geometry
+    if (!winset.fullscreen)
+        saveSettings();
+
+    // set to fullscreen mode on the monitor
+    winset.monitor = CLAMP(monitor, 0, count - 1);
+    GLFWmonitor *m = monitors[winset.monitor];
+    const GLFWvidmode *mode = glfwGetVideoMode(m);
+    glfwSetWindowMonitor( window_, m, 0, 0, mode->width, mode->height, mode->refreshRate );
+    winset.fullscreen = true;
+}
+
+void OutputWindow::setSwapInterval(int interval)
+{
+    swap_interval_ = MAXI(interval, 0);
+    Settings::application.windows[index_].swap_interval = swap_interval_;
+}
+
+void OutputWindow::saveSettings()
+{
+    if (window_ == nullptr)
+        return;
+
+    Settings::WindowConfig &winset = Settings::application.windows[index_];
+    if (!winset.fullscreen) {
+        glfwGetWindowPos(window_, &winset.x, &winset.y);
+        glfwGetWindowSize(window_, &winset.w, &winset.h);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef OUTPUTWINDOW_H
+#define OUTPUTWINDOW_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#define OUTPUT_RING_SIZE 3
+
+class FrameBuffer;
+struct GLFWwindow;
+
+/**
+ * @brief The OutputWindow class shows a frame buffer in a window of its own
+ *
+ * The window shares the GL context of the main window: each frame is
+ * copied into a ring of frame buffers of the window, and the thread of
+ * the window blits (letterboxed) the texture of the copy to the window,
+ * without rendering again. Blit and swap are done in the thread so that
+ * its swap interval never stalls the main loop; the thread waits on the
+ * GPU for a fence inserted after the copy, and inserts a fence after its
+ * blit for the main thread to wait on before copying into it again.
+ *
+ * The geometry of the window is kept in Settings::application.windows
+ * (index > 0; the first is the main window).
+ */
+class OutputWindow
+{
+public:
+    // create window (main thread), sharing the context of the given window
+    OutputWindow(int index, GLFWwindow *share);
+    ~OutputWindow();
+
+    inline bool failed() const { return window_ == nullptr; }
+    inline int index() const { return index_; }
+    bool shouldClose() const;
+
+    // give the frame to show (main thread, once per frame)
+    void setFrame(FrameBuffer *frame);
+
+    // fullscreen on monitor, or windowed if monitor < 0 (main thread)
+    void setMonitor(int monitor);
+    // 0 for immediate swap, 1 for vertical sync
+    void setSwapInterval(int interval);
+
+    // keep window geometry in settings (main thread)
+    void saveSettings();
+
+    // number of frames shown, and average duration of blit and swap in ms
+    inline int frames() const { return frames_; }
+    inline float swapDuration() const { return swap_duration_; }
+
+private:
+    void loop();
+    static void resizeCallback(GLFWwindow *window, int width, int height);
+
+    int index_;
+    GLFWwindow *window_;
+    std::thread thread_;
+
+    // copies of frames (main thread)
+    FrameBuffer *ring_[OUTPUT_RING_SIZE];
+    int ring_index_;
+
+    // frame given by main thread
+    std::mutex mutex_;
+    std::condition_variable frame_ready_;
+    bool new_frame_;
+    bool running_;
+    int slot_;
+    int reading_;
+    unsigned int texture_;
+    int texture_width_, texture_height_;
+    void *fence_;
+    // fences after blit of each copy in the thread of the window
+    void *read_fence_[OUTPUT_RING_SIZE];
+
+    std::atomic<int> width_, height_;
+    std::atomic<int> swap_interval_;
+    std::atomic<int> frames_;
+    std::atomic<float> swap_duration_;
+};
+
+#endif // OUTPUTWINDOW_H
@@ -14,12 +14,21 @@
 PickingVisitor::PickingVisitor(glm::vec2 coordinates) : Visitor(), point_(coordinates)
 {
     modelview_ = glm::mat4(1.f);
+    modelview_inverse_ = glm::mat4(1.f);
+}
+
+void PickingVisitor::setModelview(const glm::mat4 &modelview, const glm::mat4 &inverse)
+{
+    modelview_ = modelview;
+    modelview_inverse_ = inverse;
 }
 
 void PickingVisitor::visit(Node &n)
 {
     // use the transform modified during update
+    // and its cached inverse to avoid inverting modelview
     modelview_ *= n.transform_;
+    modelview_inverse_ = n.inverseTransform() * modelview_inverse_;
 
 //      modelview_ *= transform(n.translation_, n.rotation_, n.scale_);
 //    Log::Info("Node %d", n.id());
@@ -29,18 +38,22 @@ void PickingVisitor::visit(Node &n)
 void PickingVisitor::visit(Group &n)
 {
     glm::mat4 mv = modelview_;
+    glm::mat4 mvi = modelview_inverse_;
     for (NodeSet::iterator node = n.begin(); node != n.end(); node++) {
         if ( (*node)->visible_ )
             (*node)->accept(*this);
         modelview_ = mv;
+        modelview_inverse_ = mvi;
     }
 }
 
 void PickingVisitor::visit(Switch &n)
 {
     glm::mat4 mv = modelview_;
+    glm::mat4 mvi = modelview_inverse_;
     (*n.activeChild())->accept(*this);
     modelview_ = mv;
+    modelview_inverse_ = mvi;
 }
 
 void PickingVisitor::visit(Primitive &n)
@@ -55,7 +68,7 @@ void PickingVisitor::visit(Surface &n)
         return;
 
     // apply inverse transform to the point of interest
-    glm::vec4 P = glm::inverse(modelview_) * glm::vec4( point_, 0.f, 1.f );
+    glm::vec4 P = modelview_inverse_ * glm::vec4( point_, 0.f, 1.f );
 
     // test bounding box: it is an exact fit for a resctangular surface
     if ( n.bbox().contains( glm::vec3(P)) )
@@ -75,7 +88,7 @@ void PickingVisitor::visit(Handles &n)
         return;
 
     // apply inverse transform to the point of interest
-    glm::vec4 P = glm::inverse(modelview_) * glm::vec4( point_, 0.f, 1.f );
+    glm::vec4 P = modelview_inverse_ * glm::vec4( point_, 0.f, 1.f );
 
     // get the bounding box of a handle
     GlmToolkit::AxisAlignedBoundingBox bb = n.handle()->bbox();
@@ -102,8 +115,8 @@ void PickingVisitor::visit(Handles &n)
     else if ( n.type() == Handles::ROTATE ){
         // Picking Rotation icon
         glm::vec4 pos = modelview_ * glm::vec4(1.08f, 1.08f, 0.f, 1.f);
-        glm::mat4 ctm = GlmToolkit::transform(glm::vec3(pos), glm::vec3(0.f), glm::vec3(1.f));
-        glm::vec4 P = glm::inverse(ctm) * glm::vec4( point_, 0.f, 1.f );
+        // ctm is a translation to pos: inverse is translation by -pos
+        glm::vec4 P = glm::vec4( point_ - glm::vec2(pos), 0.f, 1.f );
 
         bb = n.handle()->bbox();
         picked = bb.contains( glm::vec3(P) );
@@ -118,7 +131,7 @@ void PickingVisitor::visit(Handles &n)
 void PickingVisitor::visit(LineSquare &)
 {
     // apply inverse transform to the point of interest
-    glm::vec4 P = glm::inverse(modelview_) * glm::vec4( point_, 0.f, 1.f );
+    glm::vec4 P = modelview_inverse_ * glm::vec4( point_, 0.f, 1.f );
 
     // lower left corner
     glm::vec3 LL = glm::vec3( -1.f, -1.f, 0.f );
@@ -132,7 +145,7 @@ void PickingVisitor::visit(LineSquare &)
 void PickingVisitor::visit(LineCircle &n)
 {
     // apply inverse transform to the point of interest
-    glm::vec4 P = glm::inverse(modelview_) * glm::vec4( point_, 0.f, 1.f );
+    glm::vec4 P = modelview_inverse_ * glm::vec4( point_, 0.f, 1.f );
 
     float r = glm::length( glm::vec2(P) );
     if ( r < 1.02 && r > 0.98)
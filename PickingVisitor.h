@@ -11,6 +11,7 @@ class PickingVisitor: public Visitor
 {
     glm::vec2 point_;
     glm::mat4 modelview_;
+    glm::mat4 modelview_inverse_;
     std::vector< std::pair<Node *, glm::vec2> > nodes_;
 
 public:
@@ -19,6 +20,9 @@ public:
     PickingVisitor(glm::vec2 coordinates);
     std::vector< std::pair<Node *, glm::vec2> > picked() { return nodes_; }
 
+    // set the modelview (and its inverse) before visiting a node
+    void setModelview(const glm::mat4 &modelview, const glm::mat4 &inverse);
+
     // Elements of Scene
     void visit(Scene& n) override;
     void visit(Node& n) override;
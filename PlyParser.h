@@ -0,0 +1,21 @@
+#ifndef PLYPARSER_H
+#define PLYPARSER_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief parsePLY reads an ASCII PLY file
+ *
+ * Used at runtime for PLY files without binary mesh (see MeshFile.h),
+ * and at build time by the meshconvert tool.
+ */
+bool parsePLY(std::string ascii,
+              std::vector<glm::vec3> &outPositions,
+              std::vector<glm::vec4> &outColors,
+              std::vector<glm::vec2> &outUV,
+              std::vector<uint> &outIndices,
+              uint &outPrimitive);
+
+#endif // PLYPARSER_H
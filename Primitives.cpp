@@ -5,6 +5,7 @@
 #include "MediaPlayer.h"
 #include "Visitor.h"
 #include "Log.h"
+#include "GlState.h"
 
 #include <glad/glad.h>
 
@@ -89,13 +90,11 @@ void Surface::draw(glm::mat4 modelview, glm::mat4 projection)
         init();
 
     if ( textureindex_ )
-        glBindTexture(GL_TEXTURE_2D, textureindex_);
+        GlState::bindTexture(0, textureindex_);
     else
-        glBindTexture(GL_TEXTURE_2D, Resource::getTextureBlack());
+        GlState::bindTexture(0, Resource::getTextureBlack());
 
     Primitive::draw(modelview, projection);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 ImageSurface::ImageSurface(const std::string& path, Shader *s) : Surface(s), resource_(path)
@@ -189,11 +188,9 @@ void FrameBufferSurface::draw(glm::mat4 modelview, glm::mat4 projection)
     if ( !initialized() )
         init();
 
-    glBindTexture(GL_TEXTURE_2D, frame_buffer_->texture());
+    GlState::bindTexture(0, frame_buffer_->texture());
 
     Primitive::draw(modelview, projection);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void FrameBufferSurface::accept(Visitor& v)
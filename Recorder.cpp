@@ -0,0 +1,91 @@
+#include "Recorder.h"
+
+#include <gst/app/gstappsrc.h>
+
+#include "defines.h"
+#include "Log.h"
+#include "SystemToolkit.h"
+#include "TaskScheduler.h"
+
+// maximum number of frames waiting for the encoder before dropping
+#define RECORDER_MAX_QUEUED 8
+
+const char* Recorder::profile_name[4] = { "H264 (mp4)", "H264 (mkv)", "VP8 (webm)", "JPEG (avi)" };
+
+static const char* profile_extension[4] = { "mp4", "mkv", "webm", "avi" };
+
+// realtime presets: favor encoding speed
+static const char* profile_encoder[4] = {
+    "x264enc tune=zerolatency speed-preset=superfast pass=qual quantizer=20 ! video/x-h264, profile=high ! h264parse ! mp4mux",
+    "x264enc tune=zerolatency speed-preset=superfast pass=qual quantizer=20 ! h264parse ! matroskamux",
+    "vp8enc deadline=1 cpu-used=8 ! webmmux",
+    "jpegenc quality=90 ! avimux"
+};
+
+Recorder::Recorder(uint width, uint height, int profile, const std::string &path) : FrameGrabber(width, height)
+{
+    profile = CLAMP(profile, 0, 3);
+
+    // file name from date
+    filename_ = path;
+    if (!filename_.empty() && filename_.back() != PATH_SEP)
+        filename_ += PATH_SEP;
+    filename_ += std::string(APP_NAME) + "_" + SystemToolkit::date_time_string() + "." + profile_extension[profile];
+
+    // build string describing pipeline (frames are read bottom-up)
+    std::string description = "videoflip method=vertical-flip ! videoconvert ! ";
+    description += std::string(profile_encoder[profile]) + " ! filesink location=\"" + filename_ + "\"";
+
+    if ( init(description, true, RECORDER_MAX_QUEUED) )
+        Log::Info("Recording %d x %d to %s", width_, height_, filename_.c_str());
+}
+
+Recorder::~Recorder()
+{
+    stop();
+}
+
+void Recorder::stop()
+{
+    if (pipeline_ == nullptr)
+        return;
+
+    GstElement *pipeline = pipeline_;
+    pipeline_ = nullptr;
+
+    if (src_) {
+        // last frames read
+        if (!failed_)
+            pushFrames(true);
+        // end of stream
+        gst_app_src_end_of_stream (GST_APP_SRC (src_));
+        gst_object_unref (src_);
+        src_ = nullptr;
+    }
+
+    // wait for the end of stream in a task, and inform when done
+    std::string filename = filename_;
+    int frames = frames_;
+    int dropped = dropped_;
+    TaskScheduler::manager().async<bool>("Record " + filename,
+        [=]() {
+            bool ok = true;
+            GstBus *bus = gst_element_get_bus (pipeline);
+            GstMessage *msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+                                                          (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+            if (msg == nullptr || GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+                ok = false;
+            if (msg)
+                gst_message_unref (msg);
+            gst_object_unref (bus);
+            gst_element_set_state (pipeline, GST_STATE_NULL);
+            gst_object_unref (pipeline);
+            return ok;
+        },
+        [=](std::shared_future<bool> finished) {
+            if ( finished.get() )
+                Log::Notify("Recorded %d frames to %s (%d dropped).", frames, filename.c_str(), dropped);
+            else
+                Log::Warning("Failed to record %s.", filename.c_str());
+        }, TaskScheduler::PRIORITY_HIGH);
+}
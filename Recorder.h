@@ -0,0 +1,33 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <string>
+
+#include "FrameGrabber.h"
+
+/**
+ * @brief The Recorder class records frame buffers into a video file in real time
+ *
+ * Frames are read asynchronously and encoded in the streaming thread
+ * of the pipeline (see FrameGrabber): the render loop never waits for
+ * the encoder, and a frame is dropped if the encoder is too far behind.
+ */
+class Recorder : public FrameGrabber
+{
+public:
+    // codec and container of recordings
+    static const char* profile_name[4];
+
+    Recorder(uint width, uint height, int profile, const std::string &path);
+    ~Recorder();
+
+    // encode pending frames and finish the file in the background
+    void stop() override;
+
+    inline std::string filename() const { return filename_; }
+
+private:
+    std::string filename_;
+};
+
+#endif // RECORDER_H
@@ -1,4 +1,5 @@
 #include <cstring>
+#include <algorithm>
 #include <thread>
 #include <mutex>
 #include <chrono>
@@ -28,6 +29,11 @@
 #include <gst/gl/gl.h>
 #include <gst/gl/gstglcontext.h>
 
+#ifdef USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 #ifdef GLFW_EXPOSE_NATIVE_COCOA
 #include <gst/gl/cocoa/gstgldisplay_cocoa.h>
 #endif
@@ -44,6 +50,11 @@
 #include "Resource.h"
 #include "Settings.h"
 #include "Mixer.h"
+#include "Shader.h"
+#include "GlState.h"
+#include "FrameBuffer.h"
+#include "ImageFilter.h"
+#include "OutputWindow.h"
 #include "SystemToolkit.h"
 #include "UserInterfaceManager.h"
 #include "RenderingManager.h"
@@ -52,6 +63,12 @@
 static GstGLContext *global_gl_context = NULL;
 static GstGLDisplay *global_display = NULL;
 
+#ifdef USE_EGL
+// offscreen context of headless mode
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLContext egl_context = EGL_NO_CONTEXT;
+#endif
+
 static void glfw_error_callback(int error, const char* description)
 {
     Log::Error("Glfw Error %d: %s",  error, description);
@@ -67,6 +84,83 @@ Rendering::Rendering()
     main_window_ = nullptr;
     request_screenshot_ = false;
     dpi_scale_ = 1.f;
+    headless_ = false;
+    close_requested_ = false;
+    events_ = 0;
+}
+
+bool Rendering::InitHeadless()
+{
+#ifdef USE_EGL
+    // Mesa surfaceless platform needs no display server (GPU or llvmpipe)
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        egl_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    // otherwise default display
+    if (egl_display == EGL_NO_DISPLAY)
+        egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) {
+        Log::Error("Failed to Initialize EGL.");
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        Log::Error("Failed to bind OpenGL API in EGL.");
+        return false;
+    }
+
+    // GL 3.3 core profile context, without surface
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &num_configs) || num_configs < 1) {
+        Log::Error("Failed to find an EGL configuration.");
+        return false;
+    }
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+    if (egl_context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+        Log::Error("Failed to Create EGL surfaceless context.");
+        return false;
+    }
+
+    // Initialize OpenGL loader
+    bool err = gladLoadGLLoader((GLADloadproc) eglGetProcAddress) == 0;
+    if (err) {
+        Log::Error("Failed to initialize GLAD OpenGL loader.");
+        return false;
+    }
+    Log::Info("Headless rendering with EGL %d.%d on %s.", major, minor, (const char *) glGetString(GL_RENDERER));
+
+    // no window: the rendering area is the session frame buffer
+    headless_ = true;
+    glsl_version = "#version 150";
+    main_window_attributes_.viewport = glm::ivec2(Settings::application.windows.front().w,
+                                                   Settings::application.windows.front().h);
+    main_window_attributes_.clear_color = glm::vec4(COLOR_BGROUND, 1.0);
+
+    // Gstreamer
+    g_setenv ("GST_GL_API", "opengl3", FALSE);
+    gst_init (NULL, NULL);
+
+    return true;
+#else
+    Log::Error("Headless rendering requires EGL (not available in this build).");
+    return false;
+#endif
 }
 
 bool Rendering::Init()
@@ -115,7 +209,7 @@ bool Rendering::Init()
     glfwSetWindowPos(main_window_, winset.x, winset.y);
     glfwMakeContextCurrent(main_window_);
     glfwSwapInterval(1); // Enable vsync3
-    glfwSetWindowRefreshCallback( main_window_, WindowRefreshCallback );
+    CountEvents();
 
     // Initialize OpenGL loader
     bool err = gladLoadGLLoader((GLADloadproc) glfwGetProcAddress) == 0;
@@ -191,11 +285,19 @@ bool Rendering::Init()
     // file drop callback
     glfwSetDropCallback(main_window_, Rendering::FileDropped);
 
+    // restore output windows
+    size_t outputs = Settings::application.windows.size();
+    for (size_t i = 1; i < outputs; ++i)
+        AddOutputWindow();
+
     return true;
 }
 
 bool Rendering::isActive()
 {
+    if (headless_)
+        return !close_requested_;
+
     return !glfwWindowShouldClose(main_window_);
 }
 
@@ -210,6 +312,9 @@ void Rendering::GrabWindow(int dx, int dy)
 
 void Rendering::setWindowTitle(std::string title)
 {
+    if (headless_)
+        return;
+
     std::string window_title = std::string(APP_NAME " -- ") + title;
     glfwSetWindowTitle(main_window_, window_title.c_str());
 }
@@ -226,6 +331,13 @@ void Rendering::PushBackDrawCallback(RenderingCallback function)
 
 void Rendering::Draw()
 {
+    // no window and no user interface: only end the frame
+    if (headless_) {
+        EndFrame();
+        g_main_context_iteration(NULL, FALSE);
+        return;
+    }
+
     if ( Begin() )
     {
         UserInterface::manager().NewFrame();
@@ -245,6 +357,58 @@ void Rendering::Draw()
 
 }
 
+void Rendering::DrawOutputs()
+{
+    // output windows show the frame of the session (closed ones are removed)
+    for (auto it = output_windows_.begin(); it != output_windows_.end(); ) {
+        if ( (*it)->shouldClose() ) {
+            delete *it;
+            it = output_windows_.erase(it);
+        }
+        else {
+            (*it)->setFrame( Mixer::manager().session()->frame() );
+            ++it;
+        }
+    }
+}
+
+void Rendering::SetSwapInterval(int interval)
+{
+    if (headless_ || main_window_ == nullptr)
+        return;
+
+    glfwMakeContextCurrent(main_window_);
+    glfwSwapInterval(interval);
+}
+
+void Rendering::WaitEvents(double timeout)
+{
+    if (headless_)
+        return;
+
+    glfwWaitEventsTimeout(timeout);
+}
+
+void Rendering::WakeUp()
+{
+    if (headless_ || main_window_ == nullptr)
+        return;
+
+    glfwPostEmptyEvent();
+}
+
+void Rendering::CountEvents()
+{
+    glfwSetWindowRefreshCallback( main_window_, [](GLFWwindow *w) { Rendering::manager().events_++; WindowRefreshCallback(w); } );
+    glfwSetFramebufferSizeCallback( main_window_, [](GLFWwindow *, int, int) { Rendering::manager().events_++; } );
+    glfwSetWindowFocusCallback( main_window_, [](GLFWwindow *, int) { Rendering::manager().events_++; } );
+    glfwSetCursorPosCallback( main_window_, [](GLFWwindow *, double, double) { Rendering::manager().events_++; } );
+    glfwSetMouseButtonCallback( main_window_, [](GLFWwindow *, int, int, int) { Rendering::manager().events_++; } );
+    glfwSetScrollCallback( main_window_, [](GLFWwindow *, double, double) { Rendering::manager().events_++; } );
+    glfwSetKeyCallback( main_window_, [](GLFWwindow *, int, int, int, int) { Rendering::manager().events_++; } );
+    glfwSetCharCallback( main_window_, [](GLFWwindow *, unsigned int) { Rendering::manager().events_++; } );
+}
+
 bool Rendering::Begin()
 {
     // Poll and handle events (inputs, window resize, etc.)
@@ -257,17 +421,18 @@ bool Rendering::Begin()
     glfwMakeContextCurrent(main_window_);
     if( glfwGetWindowAttrib( main_window_, GLFW_ICONIFIED ) )
     {
-        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        // paced output shall not wait (FramePacer)
+        if (Settings::application.output_fps < 1)
+            std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
         return false;
     }
 
     // handle window resize
     glfwGetFramebufferSize(main_window_, &(main_window_attributes_.viewport.x), &(main_window_attributes_.viewport.y));
-    glViewport(0, 0, main_window_attributes_.viewport.x, main_window_attributes_.viewport.y);
+    GlState::viewport(0, 0, main_window_attributes_.viewport.x, main_window_attributes_.viewport.y);
 
     // GL Colors
-    glClearColor(main_window_attributes_.clear_color.r, main_window_attributes_.clear_color.g,
-                 main_window_attributes_.clear_color.b, main_window_attributes_.clear_color.a);
+    GlState::clearColor(main_window_attributes_.clear_color);
     glClear(GL_COLOR_BUFFER_BIT);
 
     return true;
@@ -279,17 +444,56 @@ void Rendering::End()
 
     // perform screenshot if requested
     if (request_screenshot_) {
-        screenshot_.CreateFromCaptureGL(0, 0, main_window_attributes_.viewport.x, main_window_attributes_.viewport.y);
+        screenshot_.CaptureGL(0, 0, main_window_attributes_.viewport.x, main_window_attributes_.viewport.y);
         request_screenshot_ = false;
     }
 
     // swap GL buffers
     glfwSwapBuffers(main_window_);
+
+    EndFrame();
+}
+
+void Rendering::EndFrame()
+{
+    // end of frame for GL statistics
+    ShadingProgram::frameStatistics();
+    GlState::frameStatistics();
+    ImageFilter::frameStatistics();
+
+    // get pixels of screenshot when read
+    screenshot_.ResolveCaptureGL();
+
+    // delete render targets unused for a while
+    FrameBuffer::updatePool();
+
+    // GL state may be modified outside of the scene rendering (e.g. ImGui)
+    GlState::invalidate();
 }
 
 
 void Rendering::Terminate()
 {
+#ifdef USE_EGL
+    if (headless_) {
+        eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(egl_display, egl_context);
+        eglTerminate(egl_display);
+        return;
+    }
+#endif
+
+    // output windows, kept in settings after the main window
+    std::vector<Settings::WindowConfig> windows;
+    windows.push_back( Settings::application.windows.front() );
+    for (auto it = output_windows_.begin(); it != output_windows_.end(); ++it) {
+        (*it)->saveSettings();
+        windows.push_back( Settings::application.windows[(*it)->index()] );
+        delete *it;
+    }
+    output_windows_.clear();
+    Settings::application.windows = windows;
+
     // settings
     if ( !Settings::application.windows.front().fullscreen) {
         int x, y;
@@ -307,9 +511,51 @@ void Rendering::Terminate()
 }
 
 
+OutputWindow *Rendering::AddOutputWindow()
+{
+    if (headless_)
+        return nullptr;
+
+    // first index of settings not used by an output window
+    int index = 1;
+    for (bool used = true; used; ) {
+        used = false;
+        for (auto it = output_windows_.begin(); it != output_windows_.end(); ++it) {
+            if ( (*it)->index() == index ) {
+                used = true;
+                ++index;
+            }
+        }
+    }
+
+    OutputWindow *output = new OutputWindow(index, main_window_);
+    if (output->failed()) {
+        delete output;
+        return nullptr;
+    }
+    output_windows_.push_back(output);
+
+    // keep focus on user interface
+    glfwFocusWindow(main_window_);
+
+    return output;
+}
+
+void Rendering::RemoveOutputWindow(OutputWindow *output)
+{
+    auto it = std::find(output_windows_.begin(), output_windows_.end(), output);
+    if (it != output_windows_.end()) {
+        delete *it;
+        output_windows_.erase(it);
+    }
+}
+
 void Rendering::Close()
 {
-    glfwSetWindowShouldClose(main_window_, true);
+    if (headless_)
+        close_requested_ = true;
+    else
+        glfwSetWindowShouldClose(main_window_, true);
 }
 
 
@@ -319,8 +565,8 @@ void Rendering::PushAttrib(RenderingAttrib ra)
     draw_attributes_.push_front(ra);
 
     // apply Changes to OpenGL
-    glViewport(0, 0, ra.viewport.x, ra.viewport.y);
-    glClearColor(ra.clear_color.r, ra.clear_color.g, ra.clear_color.b, ra.clear_color.a);
+    GlState::viewport(0, 0, ra.viewport.x, ra.viewport.y);
+    GlState::clearColor(ra.clear_color);
 }
 
 void Rendering::PopAttrib()
@@ -333,8 +579,8 @@ void Rendering::PopAttrib()
     RenderingAttrib ra = currentAttrib();
 
     // apply Changes to OpenGL
-    glViewport(0, 0, ra.viewport.x, ra.viewport.y);
-    glClearColor(ra.clear_color.r, ra.clear_color.g, ra.clear_color.b, ra.clear_color.a);
+    GlState::viewport(0, 0, ra.viewport.x, ra.viewport.y);
+    GlState::clearColor(ra.clear_color);
 }
 
 RenderingAttrib Rendering::currentAttrib()
@@ -441,12 +687,15 @@ float Rendering::AspectRatio()
 
 void Rendering::FileDropped(GLFWwindow *, int path_count, const char* paths[])
 {
+    Rendering::manager().events_++;
     for (int i = 0; i < path_count; ++i) {
         std::string filename(paths[i]);
         if (filename.empty())
             break;
-        // try to create a source
-        Mixer::manager().insertSource ( Mixer::manager().createSourceFile( filename ) );
+        // try to create a source (between frames)
+        Mixer::manager().post( [filename]() {
+            Mixer::manager().insertSource ( Mixer::manager().createSourceFile( filename ) );
+        });
     }
 }
 
@@ -456,10 +705,14 @@ Screenshot *Rendering::CurrentScreenshot()
     return &screenshot_;
 }
 
-void Rendering::RequestScreenshot() 
+void Rendering::RequestScreenshot(FrameBuffer *frame)
 { 
     screenshot_.Clear();
-    request_screenshot_ = true;
+    // frame buffer is read now, window is read at end of frame
+    if (frame)
+        screenshot_.CaptureFrameBuffer(frame);
+    else
+        request_screenshot_ = true;
 }
 
 
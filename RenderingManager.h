@@ -3,12 +3,16 @@
 
 #include <string>
 #include <list>
+#include <vector>
 
 #include <gst/gl/gl.h>
 #include <glm/glm.hpp> 
 
 #include "Screenshot.h"
 
+class FrameBuffer;
+class OutputWindow;
+
 struct RenderingAttrib
 {
     RenderingAttrib() {}
@@ -26,6 +30,10 @@ class Rendering
     std::string glsl_version;
     float dpi_scale_;
 
+    // offscreen rendering without window
+    bool headless_;
+    bool close_requested_;
+
     // Private Constructor
     Rendering();
     Rendering(Rendering const& copy);            // Not Implemented
@@ -42,10 +50,23 @@ public:
 
     // Initialization OpenGL and GLFW window creation
     bool Init();
+    // Initialization of an offscreen OpenGL context without window (EGL)
+    bool InitHeadless();
+    inline bool isHeadless() const { return headless_; }
     // true if active rendering window
     bool isActive();
     // draw one frame
     void Draw();
+    // give the frame of the session to output windows
+    void DrawOutputs();
+    // swap interval of the UI window (1 for vertical sync)
+    void SetSwapInterval(int interval);
+    // block until events of windows, or timeout (in seconds)
+    void WaitEvents(double timeout);
+    // end the wait for events (from any thread)
+    void WakeUp();
+    // number of events of the main window (input, resize, refresh...)
+    inline unsigned int events() const { return events_; }
     // request close of the UI (Quit the program)
     void Close();
     // Post-loop termination
@@ -63,11 +84,17 @@ public:
     void PopAttrib();
     RenderingAttrib currentAttrib();
 
-    // request screenshot
-    void RequestScreenshot();
+    // request screenshot of the window, or of the frame buffer if given
+    // (asynchronous: the screenshot is full a frame or two later)
+    void RequestScreenshot(FrameBuffer *frame = nullptr);
     // get Screenshot
     class Screenshot *CurrentScreenshot();
     
+    // output windows, showing the frame of the session
+    OutputWindow *AddOutputWindow();
+    void RemoveOutputWindow(OutputWindow *output);
+    inline const std::vector<OutputWindow *> &OutputWindows() const { return output_windows_; }
+
     // window management
     void setWindowTitle(std::string title);
     // request fullscreen
@@ -95,6 +122,8 @@ private:
     bool Begin();
     // loop update end frame
     void End();
+    // statistics and garbage collection at end of frame
+    void EndFrame();
 
     // list of rendering attributes
     std::list<RenderingAttrib> draw_attributes_;
@@ -105,10 +134,15 @@ private:
 
     // file drop callback
     static void FileDropped(GLFWwindow* main_window_, int path_count, const char* paths[]);
+    // count events of main window (set before UI callbacks, which chain them)
+    void CountEvents();
+    unsigned int events_;
 
     Screenshot screenshot_;
     bool request_screenshot_;
 
+    std::vector<OutputWindow *> output_windows_;
+
     // for opengl pipeline in gstreamer
     void LinkPipeline( GstPipeline *pipeline );
 };
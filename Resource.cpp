@@ -1,6 +1,7 @@
 #include "defines.h"
 #include "Resource.h"
 #include "Log.h"
+#include "GlState.h"
 
 #include <fstream>
 #include <sstream>
@@ -32,7 +33,7 @@ uint Resource::getTextureBlack()
     // generate texture (once)
     if (tex_index_black == 0) {
         glGenTextures(1, &tex_index_black);
-        glBindTexture( GL_TEXTURE_2D, tex_index_black);
+        GlState::bindTexture(0, tex_index_black);
         unsigned char clearColor[4] = {0, 0, 0, 255};
         // texture with one black pixel
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, clearColor);
@@ -48,7 +49,7 @@ uint Resource::getTextureWhite()
     // generate texture (once)
     if (tex_index_white == 0) {
         glGenTextures(1, &tex_index_white);
-        glBindTexture( GL_TEXTURE_2D, tex_index_white);
+        GlState::bindTexture(0, tex_index_white);
         unsigned char clearColor[4] = {255, 255, 255, 255};
         // texture with one black pixel
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, clearColor);
@@ -78,6 +79,12 @@ const char *Resource::getData(const std::string& path, size_t* out_file_size){
     return data;
 }
 
+bool Resource::hasFile(const std::string& path)
+{
+    auto fs = cmrc::vmix::get_filesystem();
+    return fs.is_file(path);
+}
+
 std::string Resource::getText(const std::string& path){
 
     auto fs = cmrc::vmix::get_filesystem();
@@ -167,7 +174,7 @@ uint Resource::getTextureDDS(const std::string& path, float *aspect_ratio)
 	glGenTextures(1, &textureID);
 
 	// Bind the newly created texture
-	glBindTexture(GL_TEXTURE_2D, textureID);
+    GlState::bindTexture(0, textureID);
 	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
@@ -235,7 +242,7 @@ uint Resource::getTextureImage(const std::string& path, float *aspect_ratio)
     ar = static_cast<float>(w) / static_cast<float>(h);
 
     glGenTextures(1, &textureID);
-	glBindTexture( GL_TEXTURE_2D, textureID);
+    GlState::bindTexture(0, textureID);
 
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     //glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
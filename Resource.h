@@ -31,6 +31,9 @@ namespace Resource
     // Generic access to pointer to data
     const char *getData(const std::string& path, size_t* out_file_size);
 
+    // true if the file is in the resources
+    bool hasFile(const std::string& path);
+
     // list files in resource directory
     std::string listDirectory();
 
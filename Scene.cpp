@@ -7,6 +7,7 @@
 #include "Log.h"
 #include "GlmToolkit.h"
 #include "SessionVisitor.h"
+#include "TaskScheduler.h"
 
 #include <glad/glad.h>
 
@@ -15,27 +16,59 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/random.hpp>
 
-#include <chrono>
-#include <ctime>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 
 // Node
-Node::Node() : initialized_(false), visible_(true), refcount_(0)
+std::atomic<uint> Node::world_version_counter_(0);
+
+// unique ids and registry of all nodes (created in any thread)
+static std::atomic<int> node_id_counter_(0);
+static std::unordered_map<int, Node *> node_registry_;
+static std::mutex node_registry_access_;
+
+Node::Node() : owner_(INVALID_ID), initialized_(false), transform_dirty_(true), inverse_dirty_(true), world_dirty_(true),
+    world_version_(0), parent_version_(0), visible_(true), refcount_(0)
 {
-    // create unique id
-    auto duration = std::chrono::system_clock::now().time_since_epoch();
-    id_ = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() % 100000000;
+    // create unique id and register
+    id_ = ++node_id_counter_;
+    node_registry_access_.lock();
+    node_registry_[id_] = this;
+    node_registry_access_.unlock();
 
     transform_ = glm::identity<glm::mat4>();
     scale_ = glm::vec3(1.f);
     rotation_ = glm::vec3(0.f);
     translation_ = glm::vec3(0.f);
+
+    parent_world_ = glm::identity<glm::mat4>();
+    world_ = glm::identity<glm::mat4>();
 }
 
 Node::~Node ()
 {
+    node_registry_access_.lock();
+    node_registry_.erase(id_);
+    node_registry_access_.unlock();
+}
 
+Node *Node::find(int id)
+{
+    Node *n = nullptr;
+    node_registry_access_.lock();
+    auto it = node_registry_.find(id);
+    if (it != node_registry_.end())
+        n = it->second;
+    node_registry_access_.unlock();
+    return n;
+}
+
+void Node::setOwner(int id)
+{
+    owner_ = id;
 }
 
 void Node::copyTransform(Node *other)
@@ -50,8 +83,45 @@ void Node::copyTransform(Node *other)
 
 void Node::update( float )
 {
-    // update transform matrix from attributes
-    transform_ = GlmToolkit::transform(translation_, rotation_, scale_);
+    // update transform matrix from attributes, only if they changed
+    if ( transform_dirty_ || translation_ != translation_cache_ ||
+         rotation_ != rotation_cache_ || scale_ != scale_cache_ ) {
+        translation_cache_ = translation_;
+        rotation_cache_ = rotation_;
+        scale_cache_ = scale_;
+        transform_cache_ = GlmToolkit::transform(translation_, rotation_, scale_);
+        transform_dirty_ = false;
+        inverse_dirty_ = true;
+        world_dirty_ = true;
+    }
+    transform_ = transform_cache_;
+
+    // update world matrix if transform or parent world changed
+    if ( world_dirty_ ) {
+        world_ = parent_world_ * transform_;
+        world_version_ = ++world_version_counter_;
+        world_dirty_ = false;
+    }
+}
+
+glm::mat4 Node::inverseTransform()
+{
+    if (inverse_dirty_) {
+        inverse_cache_ = glm::inverse(transform_);
+        inverse_dirty_ = false;
+    }
+    return inverse_cache_;
+}
+
+void Node::setParentWorld(const glm::mat4 &world, uint version)
+{
+    // NB: versions are unique across nodes, so a node attached to several
+    // groups also detects a change of parent
+    if ( version != parent_version_ ) {
+        parent_world_ = world;
+        parent_version_ = version;
+        world_dirty_ = true;
+    }
 }
 
 void Node::accept(Visitor& v)
@@ -61,18 +131,40 @@ void Node::accept(Visitor& v)
 
 // Primitive
 
+size_t Primitive::total_vertex_bytes_ = 0;
+
+size_t Primitive::vertexBytes()
+{
+    return total_vertex_bytes_;
+}
+
+void Primitive::releaseVertexBytes(size_t bytes)
+{
+    total_vertex_bytes_ -= bytes;
+}
+
+Primitive::Primitive(Shader *s) : Node(), shader_(s), vao_(0), drawMode_(0), drawCount_(0),
+    indexType_(GL_UNSIGNED_INT), vertex_bytes_(0)
+{
+
+}
+
 Primitive::~Primitive()
 {
-    if ( vao_ )
+    if ( vao_ ) {
         glDeleteVertexArrays ( 1, &vao_);
+        total_vertex_bytes_ -= vertex_bytes_;
+    }
     if (shader_)
         delete shader_;
 }
 
 void Primitive::init()
 {
-    if ( vao_ )
+    if ( vao_ ) {
         glDeleteVertexArrays ( 1, &vao_);
+        total_vertex_bytes_ -= vertex_bytes_;
+    }
 
     // Vertex Array
     glGenVertexArrays( 1, &vao_ );
@@ -101,6 +193,10 @@ void Primitive::init()
     int sizeofIndices = indices_.size()*sizeof(uint);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeofIndices, &(indices_[0]), GL_STATIC_DRAW);
 
+    // account for memory of buffers (kept until vao_ is deleted)
+    vertex_bytes_ = sizeofPoints + sizeofColors + sizeofTexCoords + sizeofIndices;
+    total_vertex_bytes_ += vertex_bytes_;
+
     // explain how to read attributes 0, 1 and 2 (for point, color and textcoord respectively)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0 );
     glEnableVertexAttribArray(0);
@@ -155,7 +251,7 @@ void Primitive::draw(glm::mat4 modelview, glm::mat4 projection)
         //
         if (vao_) {
             glBindVertexArray( vao_ );
-            glDrawElements( drawMode_, drawCount_, GL_UNSIGNED_INT, 0  );
+            glDrawElements( drawMode_, drawCount_, indexType_, 0  );
             glBindVertexArray(0);
         }
     }
@@ -202,6 +298,30 @@ void Group::attach(Node *child)
 {
     children_.insert(child);
     child->refcount_++;
+
+    // child (and its children) belong to the owner of the group
+    if (owner() != INVALID_ID)
+        child->setOwner( owner() );
+}
+
+void Group::setOwner(int id)
+{
+    Node::setOwner(id);
+
+    for (NodeSet::iterator node = children_.begin(); node != children_.end(); node++)
+        (*node)->setOwner(id);
+}
+
+NodeSet::iterator Group::find(Node *child)
+{
+    // look among the nodes at the depth of the child
+    std::pair<NodeSet::iterator, NodeSet::iterator> range = children_.equal_range(child);
+    NodeSet::iterator it = std::find(range.first, range.second, child);
+    if (it != range.second)
+        return it;
+
+    // the depth of the child may have changed since it was sorted
+    return std::find(children_.begin(), children_.end(), child);
 }
 
 
@@ -216,13 +336,17 @@ void Group::sort()
 
 void Group::detatch(Node *child)
 {
-    // find the node with this id, and erase it out of the list of children
+    // find the node, and erase it out of the list of children
     // NB: do NOT delete with remove : this takes all nodes with same depth (i.e. equal depth in set)
-    NodeSet::iterator it = std::find_if(children_.begin(), children_.end(), hasId(child->id()));
+    NodeSet::iterator it = find(child);
     if ( it != children_.end())  {
         // detatch child from group parent
         children_.erase(it);
         child->refcount_--;
+
+        // child does not belong to the owner of the group anymore
+        if (owner() != INVALID_ID && child->owner() == owner())
+            child->setOwner(INVALID_ID);
     }
 
 }
@@ -231,10 +355,20 @@ void Group::update( float dt )
 {
     Node::update(dt);
 
-    // update every child node
-    for (NodeSet::iterator node = children_.begin();
-         node != children_.end(); node++) {
-        (*node)->update ( dt );
+    // update every child node, in parallel threads if enabled
+    if ( parallel_update_ && children_.size() > 1 ) {
+        std::vector<Node *> nodes(children_.begin(), children_.end());
+        TaskScheduler::manager().parallel_for(nodes.size(), [&](size_t i) {
+            nodes[i]->setParentWorld( world(), worldVersion() );
+            nodes[i]->update ( dt );
+        });
+    }
+    else {
+        for (NodeSet::iterator node = children_.begin();
+             node != children_.end(); node++) {
+            (*node)->setParentWorld( world(), worldVersion() );
+            (*node)->update ( dt );
+        }
     }
 }
 
@@ -297,8 +431,10 @@ void Switch::update( float dt )
     Node::update(dt);
 
     // update active child node
-    if (active_ != children_.end())
+    if (active_ != children_.end()) {
+        (*active_)->setParentWorld( world(), worldVersion() );
         (*active_)->update( dt );
+    }
 }
 
 void Switch::draw(glm::mat4 modelview, glm::mat4 projection)
@@ -339,7 +475,7 @@ void Switch::unsetActiveChild ()
 
 void Switch::setActiveChild(Node *child)
 {
-    setActiveChild( std::find_if(children_.begin(), children_.end(), hasId(child->id())) );
+    setActiveChild( find(child) );
 }
 
 void Switch::setActiveChild(NodeSet::iterator n)
@@ -419,6 +555,7 @@ Scene::Scene()
 
     workspace_  = new Group;
     workspace_->translation_.z  = 1.f;
+    workspace_->setParallelUpdate(true);
     root_->attach(workspace_);
 
     foreground_ = new Group;
@@ -10,6 +10,7 @@
 #include <set>
 #include <list>
 #include <vector>
+#include <atomic>
 
 #include "GlmToolkit.h"
 
@@ -21,11 +22,18 @@ class Group;
 /**
  * @brief The Node class is the base virtual class for all Node types
  *
- * Every Node is given a unique id at instanciation
+ * Every Node is given a unique id at instanciation,
+ * and can be retreived from its id with Node::find()
+ *
+ * A Node can be given the id of an owner node; the owner
+ * is propagated to the children attached to a Group.
  *
  * Every Node has geometric operations for translation,
  * scale and rotation. The update() function computes the
- * transform_ matrix from these components.
+ * transform_ matrix from these components; the matrix is
+ * only re-computed when a component changed.
+ * The update() function also computes the world matrix, i.e.
+ * the product of all transform_ of the parents and of the node.
  *
  * draw() shall be defined by the subclass.
  * The visible flag can be used to show/hide a Node.
@@ -41,8 +49,24 @@ class Group;
 class Node {
 
     int       id_;
+    int       owner_;
     bool      initialized_;
 
+    // cache of the transform matrix and of the components it was computed from
+    bool      transform_dirty_;
+    glm::mat4 transform_cache_;
+    bool      inverse_dirty_;
+    glm::mat4 inverse_cache_;
+    glm::vec3 scale_cache_, rotation_cache_, translation_cache_;
+
+    // world matrix, computed from the world matrix of the parent
+    bool      world_dirty_;
+    uint      world_version_;
+    uint      parent_version_;
+    glm::mat4 parent_world_;
+    glm::mat4 world_;
+    static std::atomic<uint> world_version_counter_;
+
 public:
     Node ();
     virtual ~Node ();
@@ -50,6 +74,13 @@ public:
     // unique identifyer generated at instanciation
     inline int id () const { return id_; }
 
+    // get the node with given id (nullptr if none)
+    static Node *find (int id);
+
+    // id of the owner node, set on the node and its children
+    inline int owner () const { return owner_; }
+    virtual void setOwner (int id);
+
     // must initialize the node before draw
     virtual void init () { initialized_ = true; }
     virtual bool initialized () { return initialized_; }
@@ -65,6 +96,16 @@ public:
 
     void copyTransform (Node *other);
 
+    // inverse of the transform_ matrix, computed once after each change
+    glm::mat4 inverseTransform ();
+
+    // world matrix as of last update; the version changes when the world matrix changes
+    inline glm::mat4 world () const { return world_; }
+    inline uint worldVersion () const { return world_version_; }
+
+    // set by the parent group before update
+    void setParentWorld (const glm::mat4 &world, uint version);
+
     // public members, to manipulate with care
     bool      visible_;
     uint      refcount_;
@@ -92,7 +133,7 @@ public:
 class Primitive : public Node {
 
 public:
-    Primitive(Shader *s = nullptr) : Node(), shader_(s), vao_(0), drawMode_(0), drawCount_(0) {}
+    Primitive(Shader *s = nullptr);
     virtual ~Primitive();
 
     virtual void init () override;
@@ -104,9 +145,15 @@ public:
 
     GlmToolkit::AxisAlignedBoundingBox bbox() const { return bbox_; }
 
+    // GPU memory used by vertex arrays of all primitives
+    static size_t vertexBytes();
+    static void releaseVertexBytes(size_t bytes);
+
 protected:
     Shader*   shader_;
-    uint vao_, drawMode_, drawCount_;
+    uint vao_, drawMode_, drawCount_, indexType_;
+    size_t vertex_bytes_;
+    static size_t total_vertex_bytes_;
     std::vector<glm::vec3>     points_;
     std::vector<glm::vec4>     colors_;
     std::vector<glm::vec2>     texCoords_;
@@ -129,18 +176,6 @@ typedef std::multiset<Node*, z_comparator> NodeSet;
 
 //typedef std::list<Node*> NodeSet;
 
-struct hasId: public std::unary_function<Node*, bool>
-{
-    inline bool operator()(const Node* e) const
-    {
-       return (e && e->id() == _id);
-    }
-    hasId(int id) : _id(id) { }
-private:
-    int _id;
-};
-
-
 /**
  * @brief The Group class contains a list of pointers to Nodes.
  *
@@ -157,7 +192,7 @@ private:
 class Group : public Node {
 
 public:
-    Group() : Node() {}
+    Group() : Node(), parallel_update_(false) {}
     virtual ~Group();
 
     virtual void update (float dt) override;
@@ -168,6 +203,12 @@ public:
     virtual void attach (Node *child);
     virtual void detatch (Node *child);
     virtual void sort();
+    virtual void setOwner (int id) override;
+
+    // update children in parallel threads (TaskScheduler)
+    // NB: only if children do not share nodes and do not call OpenGL in update
+    inline void setParallelUpdate (bool on) { parallel_update_ = on; }
+    inline bool parallelUpdate () const { return parallel_update_; }
 
     NodeSet::iterator begin();
     NodeSet::iterator end();
@@ -177,6 +218,8 @@ public:
 
 protected:
     NodeSet children_;
+    NodeSet::iterator find (Node *child);
+    bool parallel_update_;
 
 };
 
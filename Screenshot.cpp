@@ -2,21 +2,32 @@
 
 #include <memory.h>
 #include <assert.h>
+#include <stdint.h>
+#include <string>
 
 #include <glad/glad.h>
+#include <png.h>
 
-// standalone image loader
-#include <stb_image.h>
-#include <stb_image_write.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Log.h"
+#include "FrameBuffer.h"
+#include "TaskScheduler.h"
 
 Screenshot::Screenshot()
 {
     Width = Height = 0;
     Data = nullptr;
+    Pbo = 0;
+    PboSize = 0;
+    Fence = nullptr;
 }
 
 Screenshot::~Screenshot()
 {
+    // GL buffer and fence are deleted with the GL context
     Clear();
 }
 
@@ -25,6 +36,11 @@ bool Screenshot::IsFull()
     return Data != nullptr;
 }
 
+bool Screenshot::IsPending()
+{
+    return Fence != nullptr;
+}
+
 void Screenshot::Clear()
 {
     if (IsFull())
@@ -41,39 +57,151 @@ void Screenshot::CreateEmpty(int w, int h)
     memset(Data, 0, Width * Height * 4);
 }
 
-void Screenshot::CreateFromCaptureGL(int x, int y, int w, int h)
+void Screenshot::BeginCaptureGL(int w, int h)
 {
     Clear();
+    if (Fence)
+        glDeleteSync( (GLsync) Fence );
+    Fence = nullptr;
     Width = w;
     Height = h;
-    Data = (unsigned int*) malloc(Width * Height * 4);
 
-    // actual capture of frame buffer
+    // pixel pack buffer of the size of capture
+    if (Pbo == 0)
+        glGenBuffers(1, &Pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, Pbo);
+    if (PboSize != Width * Height * 4) {
+        PboSize = Width * Height * 4;
+        glBufferData(GL_PIXEL_PACK_BUFFER, PboSize, NULL, GL_STREAM_READ);
+    }
+}
+
+void Screenshot::EndCaptureGL()
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+}
+
+void Screenshot::CaptureGL(int x, int y, int w, int h)
+{
+    BeginCaptureGL(w, h);
+
+    // asynchronous read into pixel buffer
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, Data);
+    glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 
-    // make it usable
-    RemoveAlpha();
-    FlipVertical();
+    EndCaptureGL();
 }
 
-void Screenshot::SaveFile(const char* filename)
+void Screenshot::CaptureFrameBuffer(FrameBuffer *frame)
 {
-    if (Data)
-        stbi_write_png(filename, Width, Height, 4, Data, Width * 4);
+    if (frame == nullptr)
+        return;
+
+    BeginCaptureGL(frame->width(), frame->height());
+
+    // asynchronous read into pixel buffer
+    frame->readPixels();
+
+    EndCaptureGL();
 }
 
-void Screenshot::RemoveAlpha()
+// copy rows in reverse order with alpha set to opaque, in one pass
+static void copyOpaqueFlipped(const unsigned int *src, unsigned int *dst, int width, int height)
 {
-    unsigned int* p = Data;
-    int n = Width * Height;
-    while (n-- > 0)
-    {
-        *p |= 0xFF000000;
-        p++;
+    for (int y = 0; y < height; ++y) {
+        const unsigned int *s = src + (size_t) (height - 1 - y) * width;
+        unsigned int *d = dst + (size_t) y * width;
+        int x = 0;
+#ifdef __SSE2__
+        const __m128i alpha = _mm_set1_epi32( (int) 0xFF000000 );
+        for (; x + 4 <= width; x += 4)
+            _mm_storeu_si128( (__m128i *) (d + x),
+                              _mm_or_si128( _mm_loadu_si128( (const __m128i *) (s + x) ), alpha) );
+#endif
+        for (; x < width; ++x)
+            d[x] = s[x] | 0xFF000000;
     }
 }
 
+bool Screenshot::ResolveCaptureGL()
+{
+    if (Fence == nullptr)
+        return false;
+
+    // not finished reading; try again next frame
+    if ( glClientWaitSync( (GLsync) Fence, 0, 0) == GL_TIMEOUT_EXPIRED )
+        return false;
+    glDeleteSync( (GLsync) Fence );
+    Fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, Pbo);
+    const unsigned int *pixels = (const unsigned int *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, PboSize, GL_MAP_READ_BIT);
+    if (pixels) {
+        Data = (unsigned int*) malloc(Width * Height * 4);
+        copyOpaqueFlipped(pixels, Data, Width, Height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return IsFull();
+}
+
+static bool writePNG(const std::string &filename, int width, int height, const unsigned int *data)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        fclose(fp);
+        return false;
+    }
+
+    png_init_io(png, fp);
+    // fast encoding: one cheap filter and fastest compression
+    png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+    png_set_compression_level(png, 1);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (int y = 0; y < height; ++y)
+        png_write_row(png, (png_const_bytep) (data + (size_t) y * width));
+    png_write_end(png, NULL);
+
+    png_destroy_write_struct(&png, &info);
+    fclose(fp);
+    return true;
+}
+
+void Screenshot::SaveFile(const char* filename)
+{
+    if (!Data)
+        return;
+
+    // the task takes the pixels
+    unsigned int *data = Data;
+    Data = nullptr;
+    int w = Width, h = Height;
+    std::string file(filename);
+    TaskScheduler::manager().async<bool>("Screenshot " + file,
+        [=]() {
+            bool ok = writePNG(file, w, h, data);
+            free(data);
+            return ok;
+        },
+        [=](std::shared_future<bool> saved) {
+            if ( saved.get() )
+                Log::Notify("Screenshot saved %s", file.c_str());
+            else
+                Log::Warning("Failed to save screenshot %s", file.c_str());
+        }, TaskScheduler::PRIORITY_HIGH);
+}
+
 void Screenshot::BlitTo(Screenshot* dst, int src_x, int src_y, int dst_x, int dst_y, int w, int h) const
 {
     const Screenshot* src = this;
@@ -88,22 +216,3 @@ void Screenshot::BlitTo(Screenshot* dst, int src_x, int src_y, int dst_x, int ds
     for (int y = 0; y < h; y++)
         memcpy(dst->Data + dst_x + (dst_y + y) * dst->Width, src->Data + src_x + (src_y + y) * src->Width, w * 4);
 }
-
-void Screenshot::FlipVertical()
-{
-    int comp = 4;
-    int stride = Width * comp;
-    unsigned char* line_tmp = new unsigned char[stride];
-    unsigned char* line_a = (unsigned char*)Data;
-    unsigned char* line_b = (unsigned char*)Data + (stride * (Height - 1));
-    while (line_a < line_b)
-    {
-        memcpy(line_tmp, line_a, stride);
-        memcpy(line_a, line_b, stride);
-        memcpy(line_b, line_tmp, stride);
-        line_a += stride;
-        line_b -= stride;
-    }
-    delete[] line_tmp;
-}
-
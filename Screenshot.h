@@ -1,26 +1,46 @@
 #ifndef SCREENSHOT_H
 #define SCREENSHOT_H
 
+class FrameBuffer;
+
+/**
+ * Capture of the window or of a frame buffer.
+ *
+ * Capture is asynchronous: pixels are read into a pixel pack buffer,
+ * and ResolveCaptureGL() copies them once the GPU is done (usually
+ * at next frame). Saving encodes the PNG file in a background task.
+ */
 class Screenshot
 {
     int             Width, Height;
     unsigned int *  Data;
+    unsigned int    Pbo;
+    int             PboSize;
+    void *          Fence;
 
 public:
     Screenshot();
     ~Screenshot();
 
     bool IsFull();
+    bool IsPending();
     void Clear();
 
     void CreateEmpty(int w, int h);
-    void CreateFromCaptureGL(int x, int y, int w, int h);
 
-    void RemoveAlpha();
-    void FlipVertical();
+    // start capture of area of the current GL framebuffer, or of a frame buffer
+    void CaptureGL(int x, int y, int w, int h);
+    void CaptureFrameBuffer(FrameBuffer *frame);
+    // get pixels of capture if finished (non-blocking); call once per frame
+    bool ResolveCaptureGL();
 
+    // write PNG file in background, and clear
     void SaveFile(const char* filename);
     void BlitTo(Screenshot* dst, int src_x, int src_y, int dst_x, int dst_y, int w, int h) const;
+
+private:
+    void BeginCaptureGL(int w, int h);
+    void EndCaptureGL();
 };
 
 #endif // SCREENSHOT_H
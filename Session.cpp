@@ -5,6 +5,7 @@
 #include "FrameBuffer.h"
 #include "Session.h"
 #include "GarbageVisitor.h"
+#include "GpuMemory.h"
 
 #include "Log.h"
 
@@ -42,6 +43,13 @@ void Session::update(float dt)
 {
     failedSource_ = nullptr;
 
+    // over the GPU memory budget, first delete unused render targets
+    bool pressure = GpuMemory::overBudget();
+    if (pressure) {
+        FrameBuffer::trimPool();
+        pressure = GpuMemory::overBudget();
+    }
+
     // pre-render of all sources
     for( SourceList::iterator it = sources_.begin(); it != sources_.end(); it++){
 
@@ -49,6 +57,12 @@ void Session::update(float dt)
             failedSource_ = (*it);
         }
         else {
+            // rebuild render target of active sources, evict inactive
+            // ones while over budget
+            if ( (*it)->active() )
+                (*it)->restore();
+            else if ( pressure && (*it)->evict() )
+                pressure = GpuMemory::overBudget();
             // render the source
             (*it)->render();
             // update the source
@@ -70,10 +84,24 @@ SourceList::iterator Session::addSource(Source *s)
     render_.scene.ws()->attach(s->group(View::RENDERING));
     // insert the source to the beginning of the list
     sources_.push_front(s);
+    // index the nodes of the source
+    index(sources_.begin(), true);
     // return the iterator to the source created at the beginning
     return sources_.begin();
 }
 
+void Session::index(SourceList::iterator it, bool on)
+{
+    Source *s = *it;
+    View::Mode modes[4] = { View::RENDERING, View::MIXING, View::GEOMETRY, View::LAYER };
+    for (int m = 0; m < 4; ++m) {
+        if (on)
+            owners_[ s->group(modes[m])->id() ] = it;
+        else
+            owners_.erase( s->group(modes[m])->id() );
+    }
+}
+
 SourceList::iterator Session::deleteSource(Source *s)
 {
     // find the source
@@ -84,7 +112,8 @@ SourceList::iterator Session::deleteSource(Source *s)
         // remove Node from the rendering scene
         render_.scene.ws()->detatch( s->group(View::RENDERING) );
 
-        // erase the source from the update list & get next element
+        // erase the source from the index and update list & get next element
+        index(its, false);
         its = sources_.erase(its);
 
         // delete the source : safe now
@@ -107,7 +136,8 @@ Source *Session::popSource()
         // remove Node from the rendering scene
         render_.scene.ws()->detatch( s->group(View::RENDERING) );
 
-        // erase the source from the update list & get next element
+        // erase the source from the index and update list & get next element
+        index(its, false);
         sources_.erase(its);
     }
 
@@ -156,7 +186,13 @@ SourceList::iterator Session::find(std::string namesource)
 
 SourceList::iterator Session::find(Node *node)
 {
-    return std::find_if(sources_.begin(), sources_.end(), hasNode(node));
+    // the owner of a node of a source is one of the groups of the source
+    if (node) {
+        auto it = owners_.find( node->owner() );
+        if (it != owners_.end())
+            return it->second;
+    }
+    return sources_.end();
 }
 
 uint Session::numSource() const
@@ -2,6 +2,8 @@
 #define SESSION_H
 
 
+#include <unordered_map>
+
 #include "View.h"
 #include "Source.h"
 
@@ -57,6 +59,10 @@ protected:
     SourceList sources_;
     std::string filename_;
     std::map<View::Mode, Group*> config_;
+
+    // index of sources by the id of their groups (owners of their nodes)
+    std::unordered_map<int, SourceList::iterator> owners_;
+    void index(SourceList::iterator it, bool on);
 };
 
 #endif // SESSION_H
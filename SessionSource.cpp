@@ -1,6 +1,4 @@
 #include <glm/gtc/matrix_transform.hpp>
-#include <thread>
-#include <chrono>
 
 #include "SessionSource.h"
 
@@ -16,29 +14,9 @@
 #include "Session.h"
 #include "SessionCreator.h"
 #include "Mixer.h"
+#include "TaskScheduler.h"
 
 
-void SessionSource::loadSession(const std::string& filename, SessionSource *source)
-{
-    source->loadFinished_ = false;
-
-    // actual loading of xml file
-    SessionCreator creator( source->session_ );
-
-    if (creator.load(filename)) {
-        // all ok, validate session filename
-        source->session_->setFilename(filename);
-    }
-    else {
-        // error loading
-        Log::Notify("Failed to load Session file %s.", filename.c_str());
-        source->loadFailed_ = true;
-    }
-
-    // end thread
-    source->loadFinished_ = true;
-}
-
 SessionSource::SessionSource() : Source(), path_("")
 {
     loadFailed_ = false;
@@ -55,6 +33,9 @@ SessionSource::SessionSource() : Source(), path_("")
 
 SessionSource::~SessionSource()
 {
+    // do not receive the session if still loading
+    loading_.cancel();
+
     // delete surface
     delete sessionsurface_;
 
@@ -67,14 +48,44 @@ void SessionSource::load(const std::string &p)
 {
     path_ = p;
 
-    // launch a thread to load the session
-    std::thread ( SessionSource::loadSession, path_, this).detach();
+    // load the session in a task, into a new session
+    Session *session = new Session;
+    TaskScheduler::Cancellation token = loading_;
+    TaskScheduler::manager().async<bool>("Load " + path_,
+        [=]() {
+            // actual loading of xml file
+            SessionCreator creator( session );
+            return creator.load(p);
+        },
+        [=](std::shared_future<bool> loaded) {
+            // source was deleted
+            if ( token.cancelled() ) {
+                delete session;
+                return;
+            }
+            if ( loaded.get() ) {
+                // all ok, validate session filename and use it
+                session->setFilename(p);
+                delete session_;
+                session_ = session;
+            }
+            else {
+                // error loading
+                Log::Notify("Failed to load Session file %s.", p.c_str());
+                loadFailed_ = true;
+                delete session;
+            }
+            loadFinished_ = true;
+        }, TaskScheduler::PRIORITY_NORMAL, token);
 
     Log::Notify("Opening %s", p.c_str());
 }
 
 Session *SessionSource::detach()
 {
+    // do not receive the session if still loading
+    loading_.cancel();
+
     // remember pointer to give away
     Session *giveaway = session_;
 
@@ -98,6 +109,11 @@ uint SessionSource::texture() const
     return session_->frame()->texture();
 }
 
+size_t SessionSource::gpuBytes() const
+{
+    return Source::gpuBytes() + session_->frame()->bytes();
+}
+
 void SessionSource::init()
 {
     if ( loadFinished_ && !loadFailed_ ) {
@@ -141,10 +157,9 @@ void SessionSource::render()
             session()->deleteSource(session()->failedSource());
 
         // render the sesion into frame buffer
-        static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -1.f, 1.f);
-        renderbuffer_->begin();
-        sessionsurface_->draw(glm::identity<glm::mat4>(), projection);
-        renderbuffer_->end();
+        // (texture of session frame changes if its options change)
+        sessionsurface_->setTextureIndex( session_->frame()->texture() );
+        renderSurface(sessionsurface_);
     }
 }
 
@@ -207,10 +222,9 @@ void RenderSource::render()
         init();
     else {
         // render the view into frame buffer
-        static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -1.f, 1.f);
-        renderbuffer_->begin();
-        sessionsurface_->draw(glm::identity<glm::mat4>(), projection);
-        renderbuffer_->end();
+        // (texture of session frame changes if its options change)
+        sessionsurface_->setTextureIndex( Mixer::manager().session()->frame()->texture() );
+        renderSurface(sessionsurface_);
     }
 }
 
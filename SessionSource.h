@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include "Source.h"
+#include "TaskScheduler.h"
 
 class SessionSource : public Source
 {
@@ -14,6 +15,7 @@ public:
     void render() override;
     bool failed() const override;
     uint texture() const override;
+    size_t gpuBytes() const override;
     void accept (Visitor& v) override;
 
     // Session Source specific interface
@@ -26,7 +28,6 @@ public:
 protected:
 
     void init() override;
-    static void loadSession(const std::string& filename, SessionSource *source);
 
     Surface *sessionsurface_;
     std::string path_;
@@ -34,6 +35,7 @@ protected:
 
     std::atomic<bool> loadFailed_;
     std::atomic<bool> loadFinished_;
+    TaskScheduler::Cancellation loading_;
 };
 
 
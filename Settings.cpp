@@ -44,6 +44,8 @@ void Settings::Save()
 			window->SetAttribute("w", w.w);
 			window->SetAttribute("h", w.h);
 			window->SetAttribute("f", w.fullscreen);
+			window->SetAttribute("m", w.monitor);
+			window->SetAttribute("s", w.swap_interval);
             windowsNode->InsertEndChild(window);
 		}
 
@@ -60,10 +62,34 @@ void Settings::Save()
     applicationNode->SetAttribute("stats_corner", application.stats_corner);
     applicationNode->SetAttribute("logs", application.logs);
     applicationNode->SetAttribute("toolbox", application.toolbox);
+    applicationNode->SetAttribute("threads", application.threads);
+    applicationNode->SetAttribute("gpu_budget", application.gpu_budget);
+    applicationNode->SetAttribute("output_fps", application.output_fps);
+    applicationNode->SetAttribute("interface_fps", application.interface_fps);
+    applicationNode->SetAttribute("idle", application.idle);
+    applicationNode->SetAttribute("render_samples", application.render_samples);
+    applicationNode->SetAttribute("screenshot_output", application.screenshot_output);
     applicationNode->SetAttribute("framebuffer_ar", application.framebuffer_ar);
     applicationNode->SetAttribute("framebuffer_h", application.framebuffer_h);
     pRoot->InsertEndChild(applicationNode);
 
+    // bloc record
+    {
+        XMLElement *recordNode = xmlDoc.NewElement( "Record" );
+        recordNode->SetAttribute("path", application.record.path.c_str());
+        recordNode->SetAttribute("profile", application.record.profile);
+        pRoot->InsertEndChild(recordNode);
+    }
+
+    // bloc shared memory output
+    {
+        XMLElement *shmNode = xmlDoc.NewElement( "SharedMemory" );
+        shmNode->SetAttribute("socket_path", application.shm.socket_path.c_str());
+        shmNode->SetAttribute("format", application.shm.format);
+        shmNode->SetAttribute("resolution", application.shm.resolution);
+        pRoot->InsertEndChild(shmNode);
+    }
+
     // bloc views
     {
         XMLElement *viewsNode = xmlDoc.NewElement( "Views" );
@@ -162,10 +188,42 @@ void Settings::Load()
     pElement->QueryBoolAttribute("stats", &application.stats);
     pElement->QueryBoolAttribute("logs", &application.logs);
     pElement->QueryBoolAttribute("toolbox", &application.toolbox);
+    pElement->QueryIntAttribute("threads", &application.threads);
+    pElement->QueryIntAttribute("gpu_budget", &application.gpu_budget);
+    pElement->QueryIntAttribute("output_fps", &application.output_fps);
+    pElement->QueryIntAttribute("interface_fps", &application.interface_fps);
+    pElement->QueryBoolAttribute("idle", &application.idle);
+    pElement->QueryIntAttribute("render_samples", &application.render_samples);
+    pElement->QueryBoolAttribute("screenshot_output", &application.screenshot_output);
     pElement->QueryIntAttribute("stats_corner", &application.stats_corner);
     pElement->QueryIntAttribute("framebuffer_ar", &application.framebuffer_ar);
     pElement->QueryIntAttribute("framebuffer_h", &application.framebuffer_h);
 
+    // bloc record
+    {
+        XMLElement * recordNode = pRoot->FirstChildElement("Record");
+        if (recordNode)
+        {
+            const char *path_ = recordNode->Attribute("path");
+            if (path_)
+                application.record.path = std::string(path_);
+            recordNode->QueryIntAttribute("profile", &application.record.profile);
+        }
+    }
+
+    // bloc shared memory output
+    {
+        XMLElement * shmNode = pRoot->FirstChildElement("SharedMemory");
+        if (shmNode)
+        {
+            const char *path_ = shmNode->Attribute("socket_path");
+            if (path_)
+                application.shm.socket_path = std::string(path_);
+            shmNode->QueryIntAttribute("format", &application.shm.format);
+            shmNode->QueryIntAttribute("resolution", &application.shm.resolution);
+        }
+    }
+
     // bloc windows
 	{
 		application.windows.clear(); // trash existing list
@@ -184,6 +242,8 @@ void Settings::Load()
                 windowNode->QueryIntAttribute("w", &w.w);
                 windowNode->QueryIntAttribute("h", &w.h);
                 windowNode->QueryBoolAttribute("f", &w.fullscreen);
+                windowNode->QueryIntAttribute("m", &w.monitor);
+                windowNode->QueryIntAttribute("s", &w.swap_interval);
 
                 application.windows.push_back(w);
             }
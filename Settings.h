@@ -16,8 +16,10 @@ struct WindowConfig
     std::string name;
     int x,y,w,h;
     bool fullscreen;
+    int monitor;
+    int swap_interval;
 
-    WindowConfig(std::string n) : name(n), x(15), y(15), w(1280), h(720), fullscreen(false) { }
+    WindowConfig(std::string n) : name(n), x(15), y(15), w(1280), h(720), fullscreen(false), monitor(0), swap_interval(1) { }
 
 };
 
@@ -54,6 +56,25 @@ struct History
     }
 };
 
+struct RecordConfig
+{
+    std::string path;
+    int profile;
+
+    RecordConfig() : path(""), profile(0) { }
+
+};
+
+struct SharedMemoryConfig
+{
+    std::string socket_path;
+    int format;
+    int resolution;
+
+    SharedMemoryConfig() : socket_path("/tmp/" APP_NAME), format(0), resolution(-1) { }
+
+};
+
 struct Application
 {
     // Verification
@@ -70,6 +91,21 @@ struct Application
     bool shader_editor;
     bool toolbox;
 
+    // number of threads for parallel update (0 for all cores)
+    int  threads;
+
+    // GPU memory budget in MB (0 for unlimited)
+    int  gpu_budget;
+
+    // rate of output frames (0 for vertical sync of UI window)
+    // and maximum rate of user interface (0 for unlimited)
+    int  output_fps;
+    int  interface_fps;
+    // wait for events instead of redrawing when nothing changes
+    bool idle;
+    // multisampling of output frame (0 for none)
+    int  render_samples;
+
     // Settings of Views
     int current_view;
     std::map<int, ViewConfig> views;
@@ -77,9 +113,16 @@ struct Application
     int framebuffer_h;
 
     // multiple windows handling
-    // TODO: manage other windows
+    // first is the main window, others are output windows
     std::vector<WindowConfig> windows;
 
+    // recording of output
+    RecordConfig record;
+    // output to shared memory
+    SharedMemoryConfig shm;
+    // screenshot of output frame instead of window
+    bool screenshot_output;
+
     // recent files histories
     History recentSessions;
     History recentImport;
@@ -94,6 +137,13 @@ struct Application
         media_player = false;
         shader_editor = false;
         toolbox = false;
+        threads = 0;
+        gpu_budget = 0;
+        output_fps = 0;
+        interface_fps = 60;
+        idle = true;
+        render_samples = 0;
+        screenshot_output = false;
         current_view = 1;
         framebuffer_ar = 3;
         framebuffer_h = 1;
@@ -3,12 +3,18 @@
 #include "Log.h"
 #include "Visitor.h"
 #include "RenderingManager.h"
+#include "GlState.h"
+#include "SystemToolkit.h"
 
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <cstring>
+#include <mutex>
+#include <iterator>
+#include <cstdint>
 
 #include <glad/glad.h> 
 #include <GLFW/glfw3.h>
@@ -19,7 +25,15 @@
 #include <glm/gtx/string_cast.hpp>
 
 // Globals
-ShadingProgram *ShadingProgram::currentProgram_ = nullptr;
+unsigned int ShadingProgram::requests_ = 0;
+unsigned int ShadingProgram::uploads_ = 0;
+unsigned int ShadingProgram::frame_requests_ = 0;
+unsigned int ShadingProgram::frame_uploads_ = 0;
+bool ShadingProgram::prewarmed_ = false;
+unsigned int ShadingProgram::programs_cached_ = 0;
+unsigned int ShadingProgram::programs_compiled_ = 0;
+double ShadingProgram::initialization_time_ = 0.0;
+static std::mutex programs_access_;
 ShadingProgram simpleShadingProgram("shaders/simple.vs", "shaders/simple.fs");
 
 // Blending presets for matching with Shader::BlendMode
@@ -27,20 +41,99 @@ GLenum blending_equation[6] = { GL_FUNC_ADD, GL_FUNC_ADD, GL_FUNC_REVERSE_SUBTRA
 GLenum blending_source_function[6] = { GL_SRC_ALPHA,GL_SRC_ALPHA,GL_SRC_ALPHA,GL_SRC_ALPHA,GL_SRC_ALPHA,GL_SRC_ALPHA};
 GLenum blending_destination_function[6] = {GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE, GL_DST_COLOR, GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA};
 
+// Names in GLSL of uniforms matching ShadingProgram::Uniform
+const char* ShadingProgram::uniform_names[UNIFORM_COUNT] = { "projection", "modelview", "color", "iResolution", "stipple", "filterStep" };
+// Names in GLSL of uniform blocks matching ShadingProgram::UniformBlock
+const char* ShadingProgram::block_names[BLOCK_COUNT] = { "ImageProcessing" };
 
 
-ShadingProgram::ShadingProgram(const std::string& vertex_file, const std::string& fragment_file) : vertex_id_(0), fragment_id_(0), id_(0)
+
+ShadingProgram::ShadingProgram(const std::string& vertex_file, const std::string& fragment_file,
+                               const std::string& fragment_defines) : vertex_id_(0), fragment_id_(0), id_(0)
 {
     vertex_file_ = vertex_file;
     fragment_file_ = fragment_file;
+    fragment_defines_ = fragment_defines;
+
+    for (int u = 0; u < UNIFORM_COUNT; ++u) {
+        locations_[u] = -1;
+        valid_[u] = false;
+    }
+
+    // keep track of programs for prewarm
+    std::lock_guard<std::mutex> lock(programs_access_);
+    programs().push_back(this);
+}
+
+std::list<ShadingProgram *> &ShadingProgram::programs()
+{
+    // constructed on first use (programs are often static objects)
+    static std::list<ShadingProgram *> programs_;
+    return programs_;
+}
+
+void ShadingProgram::prewarm()
+{
+    std::list<ShadingProgram *> list;
+    {
+        std::lock_guard<std::mutex> lock(programs_access_);
+        list = programs();
+    }
+
+    prewarm(list);
+
+    Log::Info("Shaders ready in %.1f ms (%u from cache, %u compiled).", initialization_time_,
+              programs_cached_, programs_compiled_);
+    prewarmed_ = true;
+}
+
+void ShadingProgram::prewarm(const std::list<ShadingProgram *> &list)
+{
+    for (auto p = list.begin(); p != list.end(); p++) {
+        if ( !(*p)->initialized() )
+            (*p)->build();
+    }
+    GlState::useProgram(0);
 }
 
 void ShadingProgram::init()
 {
+    double elapsed = build();
+    if (prewarmed_)
+        Log::Info("Shader %s %s initialized at first use (%.1f ms).", vertex_file_.c_str(),
+                  fragment_file_.c_str(), elapsed);
+}
+
+double ShadingProgram::build()
+{
+    auto start = std::chrono::steady_clock::now();
+
     vertex_code_ = Resource::getText(vertex_file_);
     fragment_code_ = Resource::getText(fragment_file_);
-	compile();
-	link();
+
+    // insert defines after the #version line
+    if (!fragment_defines_.empty()) {
+        size_t pos = 0;
+        if (fragment_code_.compare(0, 8, "#version") == 0)
+            pos = fragment_code_.find('\n') + 1;
+        fragment_code_.insert(pos, fragment_defines_);
+    }
+
+    // load the program binary if cached, otherwise build and cache it
+    std::string filename = binaryFilename();
+    if ( loadBinary(filename) )
+        programs_cached_++;
+    else {
+        compile();
+        link();
+        saveBinary(filename);
+        programs_compiled_++;
+    }
+    resolve();
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    initialization_time_ += elapsed;
+    return elapsed;
 }
 
 bool ShadingProgram::initialized()
@@ -63,34 +156,198 @@ void ShadingProgram::compile()
     checkCompileErr();
 }
 
+static bool binaryCacheSupported()
+{
+    static int supported = -1;
+    if (supported < 0) {
+        GLint formats = 0;
+        if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0 ? 1 : 0;
+    }
+    return supported > 0;
+}
+
 void ShadingProgram::link()
 {
     id_ = glCreateProgram();
+    if ( binaryCacheSupported() )
+        glProgramParameteri(id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(id_, vertex_id_);
     glAttachShader(id_, fragment_id_);
     glLinkProgram(id_);
     checkLinkingErr();
-    glUseProgram(id_);
-    glUniform1i(glGetUniformLocation(id_, "iChannel0"), 0);
-    glUniform1i(glGetUniformLocation(id_, "iChannel1"), 1);
-    glUseProgram(0);
     glDeleteShader(vertex_id_);
     glDeleteShader(fragment_id_);
 }
 
-void ShadingProgram::use()
+void ShadingProgram::resolve()
 {
-    if (currentProgram_ == nullptr || currentProgram_ != this)
-    {
-        currentProgram_ = this;
-        glUseProgram(id_);
+    GlState::useProgram(id_);
+    glUniform1i(glGetUniformLocation(id_, "iChannel0"), 0);
+    glUniform1i(glGetUniformLocation(id_, "iChannel1"), 1);
+    // resolve location of known uniforms once (-1 if unused by program)
+    for (int u = 0; u < UNIFORM_COUNT; ++u) {
+        locations_[u] = glGetUniformLocation(id_, uniform_names[u]);
+        valid_[u] = false;
+    }
+    // bind uniform blocks to their binding point
+    for (int b = 0; b < BLOCK_COUNT; ++b) {
+        GLuint index = glGetUniformBlockIndex(id_, block_names[b]);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(id_, index, b);
+    }
+}
+
+// FNV-1a, stable across runs and platforms
+static uint64_t hashString(const std::string& s, uint64_t h = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < s.size(); ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string ShadingProgram::binaryFilename() const
+{
+    if ( !binaryCacheSupported() )
+        return "";
+
+    static std::string path;
+    static std::string driver;
+    if (path.empty()) {
+        path = SystemToolkit::settings_prepend_path("shaders");
+        if ( !SystemToolkit::file_exists(path) && !SystemToolkit::create_directory(path) )
+            Log::Warning("Cannot create shader cache %s", path.c_str());
+        driver  = std::string( (const char *) glGetString(GL_VENDOR) );
+        driver += std::string( (const char *) glGetString(GL_RENDERER) );
+        driver += std::string( (const char *) glGetString(GL_VERSION) );
+    }
+
+    uint64_t h = hashString(driver);
+    h = hashString(vertex_code_, h);
+    h = hashString(fragment_code_, h);
+
+    char key[17];
+    snprintf(key, 17, "%016llx", (unsigned long long) h);
+    return path + PATH_SEP + key + ".bin";
+}
+
+bool ShadingProgram::loadBinary(const std::string& filename)
+{
+    if ( filename.empty() || !SystemToolkit::file_exists(filename) )
+        return false;
+
+    std::ifstream file(filename, std::ios::binary);
+    GLenum format = 0;
+    if ( !file.read( (char *) &format, sizeof(GLenum)) )
+        return false;
+    std::vector<char> binary( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() );
+    if ( binary.empty() )
+        return false;
+
+    id_ = glCreateProgram();
+    glProgramBinary(id_, format, binary.data(), (GLsizei) binary.size());
+
+    // binary is rejected if the driver changed: build from source
+    int success = 0;
+    glGetProgramiv(id_, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(id_);
+        id_ = 0;
+        return false;
     }
+    return true;
+}
+
+void ShadingProgram::saveBinary(const std::string& filename)
+{
+    int success = 0;
+    glGetProgramiv(id_, GL_LINK_STATUS, &success);
+    if ( filename.empty() || !success )
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(id_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length < 1)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(id_, length, NULL, &format, binary.data());
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write( (const char *) &format, sizeof(GLenum) );
+    file.write( binary.data(), length );
+    if ( !file )
+        Log::Warning("Cannot write shader cache %s", filename.c_str());
+}
+
+void ShadingProgram::use()
+{
+    GlState::useProgram(id_);
 }
 
 void ShadingProgram::enduse()
 {
-    glUseProgram(0);
-    currentProgram_ = nullptr ;
+    GlState::useProgram(0);
+}
+
+void ShadingProgram::frameStatistics()
+{
+    frame_requests_ = requests_;
+    frame_uploads_ = uploads_;
+    requests_ = 0;
+    uploads_ = 0;
+}
+
+bool ShadingProgram::changed(Uniform u, const void *val, size_t size)
+{
+    requests_++;
+
+    // uniform not active in this program
+    if (locations_[u] < 0)
+        return false;
+
+    // same value as last upload
+    if ( valid_[u] && memcmp(values_[u], val, size) == 0 )
+        return false;
+
+    memcpy(values_[u], val, size);
+    valid_[u] = true;
+    uploads_++;
+    return true;
+}
+
+void ShadingProgram::setUniform(Uniform u, int val) {
+    if ( changed(u, &val, sizeof(int)) )
+        glUniform1i(locations_[u], val);
+}
+
+void ShadingProgram::setUniform(Uniform u, float val) {
+    if ( changed(u, &val, sizeof(float)) )
+        glUniform1f(locations_[u], val);
+}
+
+void ShadingProgram::setUniform(Uniform u, glm::vec2 val) {
+    if ( changed(u, glm::value_ptr(val), sizeof(glm::vec2)) )
+        glUniform2fv(locations_[u], 1, glm::value_ptr(val));
+}
+
+void ShadingProgram::setUniform(Uniform u, glm::vec3 val) {
+    if ( changed(u, glm::value_ptr(val), sizeof(glm::vec3)) )
+        glUniform3fv(locations_[u], 1, glm::value_ptr(val));
+}
+
+void ShadingProgram::setUniform(Uniform u, glm::vec4 val) {
+    if ( changed(u, glm::value_ptr(val), sizeof(glm::vec4)) )
+        glUniform4fv(locations_[u], 1, glm::value_ptr(val));
+}
+
+void ShadingProgram::setUniform(Uniform u, glm::mat4 val) {
+    if ( changed(u, glm::value_ptr(val), sizeof(glm::mat4)) )
+        glUniformMatrix4fv(locations_[u], 1, GL_FALSE, glm::value_ptr(val));
 }
 
 template<>
@@ -127,7 +384,7 @@ void ShadingProgram::setUniform<glm::vec4>(const std::string& name, glm::vec4 va
 template<>
 void ShadingProgram::setUniform<glm::vec3>(const std::string& name, glm::vec3 val) {
     glm::vec3 v(val);
-    glUniform4fv(glGetUniformLocation(id_, name.c_str()), 1, glm::value_ptr(v));
+    glUniform3fv(glGetUniformLocation(id_, name.c_str()), 1, glm::value_ptr(v));
 }
 
 template<>
@@ -194,21 +451,21 @@ void Shader::use()
     program_->use();
 
     // set uniforms
-    program_->setUniform("projection", projection);
-    program_->setUniform("modelview", modelview);
-    program_->setUniform("color", color);
+    program_->setUniform(ShadingProgram::UNIFORM_PROJECTION, projection);
+    program_->setUniform(ShadingProgram::UNIFORM_MODELVIEW, modelview);
+    program_->setUniform(ShadingProgram::UNIFORM_COLOR, color);
 
     iResolution = glm::vec3( Rendering::manager().currentAttrib().viewport, 0.f);
-    program_->setUniform("iResolution", iResolution);
+    program_->setUniform(ShadingProgram::UNIFORM_RESOLUTION, iResolution);
 
     // Blending Function
     if ( blending != BLEND_CUSTOM) {
-        glEnable(GL_BLEND);
-        glBlendEquation(blending_equation[blending]);
-        glBlendFunc(blending_source_function[blending], blending_destination_function[blending]);
+        GlState::enableBlend(true);
+        GlState::blendEquation(blending_equation[blending]);
+        GlState::blendFunc(blending_source_function[blending], blending_destination_function[blending]);
     }
     else
-        glDisable(GL_BLEND);
+        GlState::enableBlend(false);
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <list>
 #include <glm/glm.hpp>
 
 // Forward declare classes referenced
@@ -11,7 +12,9 @@ class Visitor;
 class ShadingProgram
 {
 public:
-    ShadingProgram(const std::string& vertex_file, const std::string& fragment_file);
+    // defines (e.g. "#define X\n") are inserted in the fragment code after #version
+    ShadingProgram(const std::string& vertex_file, const std::string& fragment_file,
+                   const std::string& fragment_defines = "");
     void init();
     bool initialized();
     void use();
@@ -19,20 +22,83 @@ public:
 	template<typename T> void setUniform(const std::string& name, T val1, T val2);
 	template<typename T> void setUniform(const std::string& name, T val1, T val2, T val3);
 
+    // Uniforms known at compile time; their locations are resolved once
+    // at link time and their last uploaded values are kept to avoid
+    // re-uploading unchanged values
+    typedef enum {
+        UNIFORM_PROJECTION = 0,
+        UNIFORM_MODELVIEW,
+        UNIFORM_COLOR,
+        UNIFORM_RESOLUTION,
+        UNIFORM_STIPPLE,
+        UNIFORM_FILTERSTEP,
+        UNIFORM_COUNT
+    } Uniform;
+    static const char* uniform_names[UNIFORM_COUNT];
+
+    // Uniform blocks known at compile time; each is bound at link time
+    // to the uniform buffer binding point of same index
+    typedef enum {
+        BLOCK_IMAGEPROCESSING = 0,
+        BLOCK_COUNT
+    } UniformBlock;
+    static const char* block_names[BLOCK_COUNT];
+
+    void setUniform(Uniform u, int val);
+    void setUniform(Uniform u, float val);
+    void setUniform(Uniform u, glm::vec2 val);
+    void setUniform(Uniform u, glm::vec3 val);
+    void setUniform(Uniform u, glm::vec4 val);
+    void setUniform(Uniform u, glm::mat4 val);
+
 	static void enduse();
 
+    // statistics on uniforms of the last frame
+    static void frameStatistics();
+    static inline unsigned int uniformRequests() { return frame_requests_; }
+    static inline unsigned int uniformUploads() { return frame_uploads_; }
+
+    // initialize all programs created so far (e.g. at startup)
+    // programs initialized later are reported as first use hitches
+    static void prewarm();
+    // initialize the given programs (e.g. before the first frame of a session)
+    static void prewarm(const std::list<ShadingProgram *> &list);
+    // statistics on program initialization
+    static inline unsigned int programsCached() { return programs_cached_; }
+    static inline unsigned int programsCompiled() { return programs_compiled_; }
+    static inline double initializationTime() { return initialization_time_; }
+
 private:
+    // load or compile the program; returns the time spent in ms
+    double build();
 	void checkCompileErr();
 	void checkLinkingErr();
 	void compile();
 	void link();
+    void resolve();
+    // program binary cache, keyed by driver and source code
+    std::string binaryFilename() const;
+    bool loadBinary(const std::string& filename);
+    void saveBinary(const std::string& filename);
+    bool changed(Uniform u, const void *val, size_t size);
 	unsigned int vertex_id_, fragment_id_, id_;
 	std::string vertex_code_;
 	std::string fragment_code_;
     std::string vertex_file_;
     std::string fragment_file_;
+    std::string fragment_defines_;
+
+    int   locations_[UNIFORM_COUNT];
+    float values_[UNIFORM_COUNT][16];
+    bool  valid_[UNIFORM_COUNT];
+
+    static unsigned int requests_, uploads_;
+    static unsigned int frame_requests_, frame_uploads_;
 
-    static ShadingProgram *currentProgram_;
+    static std::list<ShadingProgram *> &programs();
+    static bool prewarmed_;
+    static unsigned int programs_cached_, programs_compiled_;
+    static double initialization_time_;
 };
 
 class Shader
@@ -41,7 +107,7 @@ class Shader
 
 public:
     Shader();
-//    virtual ~Shader() {}
+    virtual ~Shader() {}
 
     // unique identifyer generated at instanciation
     inline int id () const { return id_; }
@@ -0,0 +1,37 @@
+#include "SharedMemoryOutput.h"
+
+#include "defines.h"
+#include "Log.h"
+#include "FrameBuffer.h"
+
+// a frame late is better than a frame dropped, but not more
+#define SHM_MAX_QUEUED 2
+
+const char* SharedMemoryOutput::format_name[5] = { "RGBA", "BGRA", "RGB", "I420", "UYVY" };
+
+SharedMemoryOutput::SharedMemoryOutput(uint width, uint height, const std::string &socket_path, int format, int resolution) :
+    FrameGrabber(width, height), socket_path_(socket_path), output_width_(width), output_height_(height)
+{
+    format = CLAMP(format, 0, 4);
+
+    // scaled output keeps aspect ratio (with even size for yuv formats)
+    if (resolution >= 0) {
+        resolution = CLAMP(resolution, 0, 3);
+        output_height_ = static_cast<uint>( FrameBuffer::resolution_height[resolution] );
+        output_width_ = static_cast<uint>( static_cast<float>(width) * static_cast<float>(output_height_) / static_cast<float>(height) );
+        output_width_ += output_width_ % 2;
+    }
+
+    // room for a few frames of the largest format in shared memory
+    size_t shm_size = 4 * static_cast<size_t>(output_width_) * static_cast<size_t>(output_height_) * 4;
+
+    // build string describing pipeline (frames are read bottom-up)
+    std::string description = "videoflip method=vertical-flip ! videoscale ! videoconvert ! ";
+    description += "video/x-raw, format=" + std::string(format_name[format]);
+    description += ", width=" + std::to_string(output_width_) + ", height=" + std::to_string(output_height_);
+    description += " ! gdppay ! shmsink name=sink sync=false wait-for-connection=false";
+    description += " shm-size=" + std::to_string(shm_size) + " socket-path=\"" + socket_path_ + "\"";
+
+    if ( init(description, true, SHM_MAX_QUEUED) )
+        Log::Info("Sharing %d x %d %s output to %s", output_width_, output_height_, format_name[format], socket_path_.c_str());
+}
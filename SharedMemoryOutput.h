@@ -0,0 +1,37 @@
+#ifndef SHAREDMEMORYOUTPUT_H
+#define SHAREDMEMORYOUTPUT_H
+
+#include <string>
+
+#include "FrameGrabber.h"
+
+/**
+ * @brief The SharedMemoryOutput class publishes frame buffers in shared memory
+ *
+ * Frames are read asynchronously (see FrameGrabber), converted to the
+ * pixel format and resolution of the output, and given to a shmsink.
+ * Buffers are serialized with GDP, so readers get the caps, the time
+ * stamps, the frame counter (offset, to detect drops) and the monotonic
+ * time of rendering in microseconds (end offset, to measure latency):
+ *
+ *   gst-launch-1.0 shmsrc socket-path=/tmp/vimix is-live=true ! gdpdepay ! videoconvert ! autovideosink
+ */
+class SharedMemoryOutput : public FrameGrabber
+{
+public:
+    // pixel formats of output
+    static const char* format_name[5];
+
+    // height of output is the resolution index of FrameBuffer, or same as frame if < 0
+    SharedMemoryOutput(uint width, uint height, const std::string &socket_path, int format, int resolution);
+
+    inline std::string socketPath() const { return socket_path_; }
+    inline uint outputWidth() const { return output_width_; }
+    inline uint outputHeight() const { return output_height_; }
+
+private:
+    std::string socket_path_;
+    uint output_width_, output_height_;
+};
+
+#endif // SHAREDMEMORYOUTPUT_H
@@ -1,5 +1,6 @@
 
 #include <algorithm>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Source.h"
@@ -10,12 +11,12 @@
 #include "Mesh.h"
 #include "Resource.h"
 #include "Session.h"
-#include "SearchVisitor.h"
 #include "ImageShader.h"
 #include "ImageProcessingShader.h"
+#include "ImageFilter.h"
 #include "Log.h"
 
-Source::Source() : initialized_(false), need_update_(true)
+Source::Source() : initialized_(false), need_render_(true), renders_(0), need_update_(true)
 {
     sprintf(initials_, "__");
     name_ = "Source";
@@ -90,9 +91,14 @@ Source::Source() : initialized_(false), need_update_(true)
     overlays_[View::LAYER]->visible_ = false;
     groups_[View::LAYER]->attach(overlays_[View::LAYER]);
 
+    // each group is the owner of all the nodes attached to it
+    for (auto g = groups_.begin(); g != groups_.end(); g++)
+        (*g).second->setOwner( (*g).second->id() );
+
     // will be associated to nodes later
     blendingshader_ = new ImageShader;
     rendershader_ = new ImageProcessingShader;
+    filter_ = new ImageFilter;
     renderbuffer_ = nullptr;
     rendersurface_ = nullptr;
 }
@@ -102,6 +108,7 @@ Source::~Source()
     // delete render objects
     if (renderbuffer_)
         delete renderbuffer_;
+    delete filter_;
 
     // all groups and their children are deleted in the scene
     // this includes rendersurface_, overlays, blendingshader_ and rendershader_
@@ -145,9 +152,74 @@ void Source::setVisible(bool on)
     groups_[View::LAYER]->visible_ = on;
 }
 
+bool Source::active() const
+{
+    if ( groups_.at(View::RENDERING)->visible_ && blendingshader_->color.a > 0.f )
+        return true;
+
+    // the clones draw the texture of the source
+    for (auto it = clones_.begin(); it != clones_.end(); it++)
+        if ( (*it)->active() )
+            return true;
+
+    return false;
+}
+
+size_t Source::gpuBytes() const
+{
+    return renderbuffer_ ? renderbuffer_->bytes() : 0;
+}
+
+bool Source::evict()
+{
+    if (!renderbuffer_ || renderbuffer_->evicted())
+        return false;
+
+    renderbuffer_->evict();
+    return true;
+}
+
+void Source::restore()
+{
+    if (renderbuffer_) {
+        // content is lost: render again
+        if (renderbuffer_->evicted())
+            need_render_ = true;
+        renderbuffer_->restore();
+    }
+}
+
+void Source::renderSurface(Surface *surface, bool changed)
+{
+    if (renderbuffer_->evicted())
+        return;
+
+    // same input and same processing: frame (and its mipmaps) unchanged
+    ImageProcessingShader::Parameters parameters = rendershader_->parameters();
+    if ( !changed && !need_render_ && memcmp(&parameters, &rendered_parameters_, sizeof(parameters)) == 0 )
+        return;
+    rendered_parameters_ = parameters;
+    need_render_ = false;
+    renders_++;
+
+    // apply separable filters in passes, and process their result
+    uint texture = surface->textureIndex();
+    surface->setTextureIndex( filter_->apply(texture, rendershader_->filterid, renderbuffer_->resolution()) );
+
+    // render the surface into frame buffer
+    static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -1.f, 1.f);
+    renderbuffer_->begin();
+    surface->draw(glm::identity<glm::mat4>(), projection);
+    renderbuffer_->end();
+
+    surface->setTextureIndex(texture);
+}
+
 void Source::attach(FrameBuffer *renderbuffer)
 {
     renderbuffer_ = renderbuffer;
+    // frame is drawn at reduced size in mixing view and previews
+    renderbuffer_->setMipmap(true);
 
     // create the surfaces to draw the frame buffer in the views
     // TODO Provide the source custom effect shader
@@ -233,27 +305,6 @@ Handles *Source::handleNode(Handles::Type t) const
         return resize_handle_;
 }
 
-bool hasNode::operator()(const Source* elem) const
-{
-    if (elem)
-    {
-        SearchVisitor sv(_n);
-        elem->group(View::MIXING)->accept(sv);
-        if (sv.found())
-            return true;
-        elem->group(View::GEOMETRY)->accept(sv);
-        if (sv.found())
-            return true;
-        elem->group(View::RENDERING)->accept(sv);
-        if (sv.found())
-            return sv.found();
-        elem->group(View::LAYER)->accept(sv);
-        return sv.found();
-    }
-
-    return false;
-}
-
 CloneSource *Source::clone()
 {
     CloneSource *s = new CloneSource(this);
@@ -263,7 +314,7 @@ CloneSource *Source::clone()
     return s;
 }
 
-CloneSource::CloneSource(Source *origin) : Source(), origin_(origin)
+CloneSource::CloneSource(Source *origin) : Source(), origin_(origin), origin_renders_(0)
 {
     // create surface:
     clonesurface_ = new Surface(rendershader_);
@@ -271,6 +322,10 @@ CloneSource::CloneSource(Source *origin) : Source(), origin_(origin)
 
 CloneSource::~CloneSource()
 {
+    // remove from the clones of the origin
+    if (origin_)
+        origin_->clones_.remove(this);
+
     // delete surface
     delete clonesurface_;
 }
@@ -310,10 +365,10 @@ void CloneSource::render()
         init();
     else {
         // render the view into frame buffer
-        static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -1.f, 1.f);
-        renderbuffer_->begin();
-        clonesurface_->draw(glm::identity<glm::mat4>(), projection);
-        renderbuffer_->end();
+        // (texture of origin changes if evicted and restored)
+        clonesurface_->setTextureIndex( origin_->texture() );
+        renderSurface(clonesurface_, origin_->renders() != origin_renders_);
+        origin_renders_ = origin_->renders();
     }
 }
 
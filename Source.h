@@ -4,12 +4,14 @@
 #include <string>
 #include <map>
 #include <list>
+#include <cstdint>
 
 #include "View.h"
 #include "Mesh.h"
+#include "ImageProcessingShader.h"
 
 class ImageShader;
-class ImageProcessingShader;
+class ImageFilter;
 class FrameBuffer;
 class FrameBufferSurface;
 class MediaPlayer;
@@ -24,6 +26,8 @@ typedef std::list<CloneSource *> CloneList;
 
 class Source
 {
+    friend class CloneSource;
+
 public:
     // create a source and add it to the list
     // only subclasses of sources can actually be instanciated
@@ -67,6 +71,20 @@ public:
     // accept all kind of visitors
     virtual void accept (Visitor& v);
 
+    // a Source is active if visible in the output (not transparent),
+    // or if one of its clones is
+    bool active() const;
+
+    // GPU memory of the source: render target and texture of the source
+    virtual size_t gpuBytes() const;
+
+    // free the GPU memory of the render target, rebuilt when needed
+    bool evict();
+    void restore();
+
+    // number of times the frame was drawn (i.e. its content changed)
+    inline uint64_t renders() const { return renders_; }
+
     // a Source shall informs if the source failed (i.e. shall be deleted)
     virtual bool failed() const = 0;
 
@@ -93,6 +111,13 @@ protected:
     FrameBuffer *renderbuffer_;
     void attach(FrameBuffer *renderbuffer);
 
+    // draw the surface into the renderbuffer, after separable filters,
+    // unless its content did not change and processing is the same
+    void renderSurface(Surface *surface, bool changed = true);
+    ImageProcessingShader::Parameters rendered_parameters_;
+    bool need_render_;
+    uint64_t renders_;
+
     // the rendersurface draws the renderbuffer in the scene
     // It is associated to the rendershader for mixing effects
     FrameBufferSurface *rendersurface_;
@@ -100,6 +125,9 @@ protected:
     // rendershader performs image processing
     ImageProcessingShader *rendershader_;
 
+    // filter applies the separable filters of rendershader_ in passes
+    ImageFilter *filter_;
+
     // blendingshader provides mixing controls
     ImageShader *blendingshader_;
 
@@ -126,15 +154,6 @@ private:
     std::string _n;
 };
 
-struct hasNode: public std::unary_function<Source*, bool>
-{
-    bool operator()(const Source* elem) const;
-    hasNode(Node *n) : _n(n) { }
-
-private:
-    Node *_n;
-};
-
 
 class CloneSource : public Source
 {
@@ -159,6 +178,7 @@ protected:
     void init() override;
     Surface *clonesurface_;
     Source *origin_;
+    uint64_t origin_renders_;
 };
 
 
@@ -0,0 +1,241 @@
+#include <chrono>
+
+#include "TaskScheduler.h"
+
+#include "defines.h"
+#include "Log.h"
+
+#define MAX_TASK_TIMINGS 10
+
+// true in threads executing iterations of a parallel_for
+static thread_local bool inside_parallel_ = false;
+
+// index of the task queue of the current thread (-1 if not a task thread)
+static thread_local int task_queue_index_ = -1;
+
+TaskScheduler::TaskScheduler() : queued_(0), next_queue_(0), pending_(0), job_(nullptr), count_(0), next_(0),
+    participants_(0), active_(0), generation_(0), concurrency_(1), quit_(false)
+{
+    unsigned int cores = MAXI(std::thread::hardware_concurrency(), 1u);
+
+    // the calling thread also participates: one worker less than cores
+    for (unsigned int i = 0; i + 1 < cores; ++i)
+        workers_.push_back( std::thread(&TaskScheduler::worker, this, i) );
+
+    // background tasks mostly wait for disk or user (dialogs):
+    // a separate pool, not competing with parallel_for workers
+    unsigned int tasks = MAXI(cores / 2, 2u);
+    for (unsigned int i = 0; i < tasks; ++i)
+        task_queues_.push_back( std::unique_ptr<TaskQueue>(new TaskQueue) );
+    for (unsigned int i = 0; i < tasks; ++i)
+        task_workers_.push_back( std::thread(&TaskScheduler::taskWorker, this, i) );
+
+    concurrency_ = cores;
+    Log::Info("Task scheduler with %d threads and %d task threads.", cores, tasks);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    mutex_.lock();
+    quit_ = true;
+    mutex_.unlock();
+    start_.notify_all();
+
+    task_mutex_.lock();
+    task_mutex_.unlock();
+    task_available_.notify_all();
+
+    for (auto t = workers_.begin(); t != workers_.end(); t++)
+        t->join();
+
+    // NB: waits for running tasks to end; queued tasks are dropped
+    for (auto t = task_workers_.begin(); t != task_workers_.end(); t++)
+        t->join();
+}
+
+void TaskScheduler::setConcurrency(unsigned int n)
+{
+    if (n == 0)
+        n = maxConcurrency();
+    concurrency_ = CLAMP(n, 1u, maxConcurrency());
+}
+
+void TaskScheduler::run()
+{
+    inside_parallel_ = true;
+    for (size_t i = next_++; i < count_; i = next_++)
+        (*job_)(i);
+    inside_parallel_ = false;
+}
+
+void TaskScheduler::worker(unsigned int index)
+{
+    unsigned int generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        // wait for a new job (or to quit)
+        start_.wait(lock, [&]{ return quit_ || generation != generation_; });
+        if (quit_)
+            break;
+        generation = generation_;
+
+        // this worker is not used for this job
+        if (index >= participants_)
+            continue;
+
+        lock.unlock();
+        run();
+        lock.lock();
+
+        // last one informs caller
+        if (--active_ == 0)
+            done_.notify_one();
+    }
+}
+
+void TaskScheduler::parallel_for(size_t count, const std::function<void(size_t)> &fn)
+{
+    // sequential
+    if (count < 2 || concurrency_ < 2 || inside_parallel_) {
+        for (size_t i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    // start the job
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &fn;
+    count_ = count;
+    next_ = 0;
+    participants_ = MINI( (size_t) concurrency_ - 1, count - 1);
+    active_ = participants_;
+    generation_++;
+    lock.unlock();
+    start_.notify_all();
+
+    // participate
+    run();
+
+    // wait for the workers to finish
+    lock.lock();
+    done_.wait(lock, [&]{ return active_ == 0; });
+    job_ = nullptr;
+}
+
+void TaskScheduler::enqueue(const std::string &name, Priority priority, std::function<void()> run)
+{
+    // a task created by a task goes into the queue of its thread,
+    // otherwise distribute tasks between queues
+    unsigned int q = 0;
+    if (task_queue_index_ < 0) {
+        std::lock_guard<std::mutex> lock(task_mutex_);
+        q = next_queue_;
+        next_queue_ = (next_queue_ + 1) % task_queues_.size();
+    }
+    else
+        q = task_queue_index_;
+
+    task_queues_[q]->mutex.lock();
+    task_queues_[q]->tasks[priority].push_back( {name, run} );
+    task_queues_[q]->mutex.unlock();
+    pending_++;
+
+    // wake up one task thread
+    task_mutex_.lock();
+    queued_++;
+    task_mutex_.unlock();
+    task_available_.notify_one();
+}
+
+bool TaskScheduler::take(unsigned int index, Task &task)
+{
+    size_t n = task_queues_.size();
+
+    // highest priority first; own queue first (front), then steal from others (back)
+    for (int p = PRIORITY_HIGH; p < PRIORITY_COUNT; ++p) {
+        for (size_t k = 0; k < n; ++k) {
+            TaskQueue *q = task_queues_[ (index + k) % n ].get();
+            std::lock_guard<std::mutex> lock(q->mutex);
+            if ( !q->tasks[p].empty() ) {
+                if (k == 0) {
+                    task = q->tasks[p].front();
+                    q->tasks[p].pop_front();
+                }
+                else {
+                    task = q->tasks[p].back();
+                    q->tasks[p].pop_back();
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::taskWorker(unsigned int index)
+{
+    task_queue_index_ = index;
+
+    while (true) {
+        // wait for a task to be queued (or to quit), and reserve it
+        {
+            std::unique_lock<std::mutex> lock(task_mutex_);
+            task_available_.wait(lock, [&]{ return quit_ || queued_ > 0; });
+            if (quit_)
+                break;
+            queued_--;
+        }
+
+        // a task was reserved: it is in one of the queues
+        Task task;
+        while ( !take(index, task) )
+            std::this_thread::yield();
+
+        // execute and measure
+        auto start = std::chrono::steady_clock::now();
+        task.run();
+        std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - start;
+        pending_--;
+
+        timings_mutex_.lock();
+        timings_.push_front( {task.name, duration.count()} );
+        if (timings_.size() > MAX_TASK_TIMINGS)
+            timings_.pop_back();
+        timings_mutex_.unlock();
+    }
+}
+
+void TaskScheduler::post(const std::string &name, std::function<void()> continuation)
+{
+    std::lock_guard<std::mutex> lock(continuations_mutex_);
+    continuations_.push_back( {name, continuation} );
+}
+
+void TaskScheduler::dispatch()
+{
+    // take the list (continuations may post or create tasks)
+    std::vector<Task> todo;
+    continuations_mutex_.lock();
+    todo.swap(continuations_);
+    continuations_mutex_.unlock();
+
+    for (auto c = todo.begin(); c != todo.end(); c++) {
+        // e.g. result of a task which failed with an exception
+        try {
+            c->run();
+        }
+        catch (const std::exception &e) {
+            Log::Warning("Task %s failed: %s", c->name.c_str(), e.what());
+        }
+        catch (...) {
+            Log::Warning("Task %s failed.", c->name.c_str());
+        }
+    }
+}
+
+std::list<TaskScheduler::TaskTiming> TaskScheduler::timings()
+{
+    std::lock_guard<std::mutex> lock(timings_mutex_);
+    return timings_;
+}
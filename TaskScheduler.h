@@ -0,0 +1,176 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <list>
+#include <string>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * @brief The TaskScheduler executes CPU work on pools of threads
+ *
+ * parallel_for() splits the iterations of a loop between the worker
+ * threads and the calling thread, and returns when all are done.
+ *
+ * async() runs a task in the background (e.g. loading a file), on a
+ * separate work-stealing pool: each task thread has its own queues
+ * (one per priority) and takes tasks from the others when idle.
+ * The optional continuation of a task is executed in the main thread,
+ * during dispatch(), called once per frame.
+ *
+ * Thread safety:
+ *  - parallel_for() shall be called from the main (rendering) thread;
+ *    a call from inside an iteration runs sequentially.
+ *  - Iterations run concurrently: they shall not issue OpenGL calls
+ *    (the GL context is current only in the main thread), and shall
+ *    not modify data accessed by other iterations.
+ *  - async() tasks shall not issue OpenGL calls either; results are
+ *    given to the main thread in the continuation.
+ */
+class TaskScheduler
+{
+    // Private Constructor
+    TaskScheduler();
+    TaskScheduler(TaskScheduler const& copy);            // Not Implemented
+    TaskScheduler& operator=(TaskScheduler const& copy); // Not Implemented
+
+public:
+
+    static TaskScheduler& manager()
+    {
+        // The only instance
+        static TaskScheduler _instance;
+        return _instance;
+    }
+    ~TaskScheduler();
+
+    // call fn(i) for i in [0, count) in parallel, and wait for completion
+    void parallel_for(size_t count, const std::function<void(size_t)> &fn);
+
+    typedef enum {
+        PRIORITY_HIGH = 0,
+        PRIORITY_NORMAL,
+        PRIORITY_LOW,
+        PRIORITY_COUNT
+    } Priority;
+
+    // shared flag to cancel a task (copies share the same flag)
+    class Cancellation
+    {
+        std::shared_ptr< std::atomic<bool> > cancelled_;
+    public:
+        Cancellation() : cancelled_(std::make_shared< std::atomic<bool> >(false)) {}
+        inline void cancel() { *cancelled_ = true; }
+        inline bool cancelled() const { return *cancelled_; }
+    };
+
+    // run work() in a task thread, then then(future) in the main thread.
+    // A task cancelled before it starts does not call work() and gives
+    // a default value, but its continuation is still called (to release
+    // resources); long tasks can check the token to stop early.
+    // An exception thrown by work() is given in the future (get() throws
+    // it again); the continuation is called in any case.
+    template<typename T>
+    std::shared_future<T> async(const std::string &name, std::function<T()> work,
+                                std::function<void(std::shared_future<T>)> then = nullptr,
+                                Priority priority = PRIORITY_NORMAL,
+                                Cancellation token = Cancellation())
+    {
+        auto promise = std::make_shared< std::promise<T> >();
+        std::shared_future<T> future = promise->get_future().share();
+        enqueue(name, priority, [=]() {
+            try {
+                if constexpr (std::is_void<T>::value) {
+                    if (!token.cancelled())
+                        work();
+                    promise->set_value();
+                }
+                else
+                    promise->set_value( token.cancelled() ? T() : work() );
+            }
+            catch (...) {
+                promise->set_exception( std::current_exception() );
+            }
+            if (then)
+                post( name, std::bind(then, future) );
+        });
+        return future;
+    }
+
+    // execute continuations of finished tasks; call from the main thread
+    // (an exception thrown by a continuation is logged)
+    void dispatch();
+
+    // timing of the last tasks executed, for statistics
+    struct TaskTiming {
+        std::string name;
+        float duration; // milliseconds
+    };
+    std::list<TaskTiming> timings();
+    inline unsigned int pendingTasks() const { return pending_; }
+
+    // number of threads sharing the work (including calling thread)
+    // 0 to use all available cores, 1 for sequential execution
+    void setConcurrency(unsigned int n);
+    inline unsigned int concurrency() const { return concurrency_; }
+    inline unsigned int maxConcurrency() const { return (unsigned int) workers_.size() + 1; }
+
+private:
+    void worker(unsigned int index);
+    void run();
+
+    // background tasks
+    struct Task {
+        std::string name;
+        std::function<void()> run;
+    };
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks[PRIORITY_COUNT];
+    };
+    void enqueue(const std::string &name, Priority priority, std::function<void()> run);
+    void post(const std::string &name, std::function<void()> continuation);
+    bool take(unsigned int index, Task &task);
+    void taskWorker(unsigned int index);
+
+    std::vector<std::thread> task_workers_;
+    std::vector< std::unique_ptr<TaskQueue> > task_queues_;
+    std::mutex task_mutex_;
+    std::condition_variable task_available_;
+    unsigned int queued_;
+    unsigned int next_queue_;
+    std::atomic<unsigned int> pending_;
+
+    std::mutex continuations_mutex_;
+    std::vector<Task> continuations_;
+
+    std::mutex timings_mutex_;
+    std::list<TaskTiming> timings_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+
+    // current job
+    const std::function<void(size_t)> *job_;
+    size_t count_;
+    std::atomic<size_t> next_;
+    unsigned int participants_;
+    unsigned int active_;
+    unsigned int generation_;
+
+    unsigned int concurrency_;
+    // read by workers of both pools, under different mutexes
+    std::atomic<bool> quit_;
+};
+
+#endif // TASKSCHEDULER_H
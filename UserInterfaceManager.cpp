@@ -1,7 +1,6 @@
 #include <iostream>
 #include <cstring>
 #include <sstream>
-#include <thread>
 #include <algorithm>
 
 // ImGui
@@ -42,10 +41,14 @@
 #include "ImGuiVisitor.h"
 #include "GstToolkit.h"
 #include "Mixer.h"
+#include "TaskScheduler.h"
 #include "FrameBuffer.h"
 #include "MediaPlayer.h"
 #include "MediaSource.h"
-#include "PickingVisitor.h"
+#include "Recorder.h"
+#include "SharedMemoryOutput.h"
+#include "OutputWindow.h"
+#include "FramePacer.h"
 #include "ImageShader.h"
 #include "ImageProcessingShader.h"
 
@@ -57,75 +60,95 @@ void ShowAboutGStreamer(bool* p_open);
 void ShowAboutOpengl(bool* p_open);
 void ShowAbout(bool* p_open);
 
-// static objects for multithreaded file dialog
+// file dialogs are executed in tasks (they block until the user answers)
 static std::atomic<bool> fileDialogPending_ = false;
-static std::atomic<bool> sessionFileDialogLoadFinished_ = false;
-static std::atomic<bool> sessionFileDialogImport_ = false;
-static std::atomic<bool> sessionFileDialogSaveFinished_ = false;
-static std::string sessionFileDialogFilename_ = "";
 
-static void SessionFileDialogOpen(std::string path)
+static std::string SessionFileDialogOpen(const std::string &path)
 {
-     fileDialogPending_ = true;
-     sessionFileDialogLoadFinished_ = false;
-
      char const * open_file_name;
      char const * open_pattern[1] = { "*.vmx" };
 
      open_file_name = tinyfd_openFileDialog( "Open a session file", path.c_str(), 1, open_pattern, "vimix session", 0);
 
      if (!open_file_name)
-        sessionFileDialogFilename_ = "";
-     else
-        sessionFileDialogFilename_ = std::string( open_file_name );
+        return "";
 
-     sessionFileDialogLoadFinished_ = true;
+     return std::string( open_file_name );
 }
 
-static void SessionFileDialogSave(std::string path)
+static std::string SessionFileDialogSave(const std::string &path)
 {
-     fileDialogPending_ = true;
-     sessionFileDialogSaveFinished_ = false;
-
      char const * save_file_name;
      char const * save_pattern[1] = { "*.vmx" };
 
      save_file_name = tinyfd_saveFileDialog( "Save a session file", path.c_str(), 1, save_pattern, "vimix session");
 
      if (!save_file_name)
-        sessionFileDialogFilename_ = "";
-     else
-     {
-        sessionFileDialogFilename_ = std::string( save_file_name );
-        // check extension
-        std::string extension = sessionFileDialogFilename_.substr(sessionFileDialogFilename_.find_last_of(".") + 1);
-        if (extension != "vmx")
-            sessionFileDialogFilename_ += ".vmx";
-     }
-
-     sessionFileDialogSaveFinished_ = true;
+        return "";
+
+     std::string filename( save_file_name );
+     // check extension
+     std::string extension = filename.substr(filename.find_last_of(".") + 1);
+     if (extension != "vmx")
+        filename += ".vmx";
+
+     return filename;
 }
 
-static void ImportFileDialogOpen(char *filename, std::atomic<bool> *success, const std::string &path)
+static std::string ImportFileDialogOpen(const std::string &path)
 {
-    if (fileDialogPending_)
-        return;
-    fileDialogPending_ = true;
-
     char const * open_pattern[18] = { "*.vmx", "*.mp4", "*.mpg", "*.avi", "*.mov", "*.mkv",  "*.webm", "*.mod", "*.wmv", "*.mxf", "*.ogg", "*.flv", "*.asf", "*.jpg", "*.png", "*.gif", "*.tif", "*.svg" };
     char const * open_file_name;
 
     open_file_name = tinyfd_openFileDialog( "Import a file", path.c_str(), 18, open_pattern, "All supported formats", 0);
 
-    if (open_file_name) {
-        sprintf(filename, "%s", open_file_name);
-        *success = true;
-    }
-    else {
-        *success = false;
-    }
+    if (!open_file_name)
+        return "";
 
-    fileDialogPending_ = false;
+    return std::string( open_file_name );
+}
+
+// launch the dialog to open (or import) a session file
+static void LaunchSessionFileDialogOpen(bool import)
+{
+    if (fileDialogPending_)
+        return;
+    fileDialogPending_ = true;
+
+    std::string path = Settings::application.recentSessions.path;
+    TaskScheduler::manager().async<std::string>("Open dialog",
+        [path]() { return SessionFileDialogOpen(path); },
+        [import](std::shared_future<std::string> selected) {
+            std::string filename = selected.get();
+            if (!filename.empty()) {
+                if (import)
+                    Mixer::manager().import(filename);
+                else
+                    Mixer::manager().open(filename);
+                Settings::application.recentSessions.path = SystemToolkit::path_filename(filename);
+            }
+            fileDialogPending_ = false;
+        });
+}
+
+// launch the dialog to save a session file
+static void LaunchSessionFileDialogSave()
+{
+    if (fileDialogPending_)
+        return;
+    fileDialogPending_ = true;
+
+    std::string path = Settings::application.recentSessions.path;
+    TaskScheduler::manager().async<std::string>("Save dialog",
+        [path]() { return SessionFileDialogSave(path); },
+        [](std::shared_future<std::string> selected) {
+            std::string filename = selected.get();
+            if (!filename.empty()) {
+                Mixer::manager().saveas(filename);
+                Settings::application.recentSessions.path = SystemToolkit::path_filename(filename);
+            }
+            fileDialogPending_ = false;
+        });
 }
 
 UserInterface::UserInterface()
@@ -215,13 +238,13 @@ void UserInterface::handleKeyboard()
         }
         else if (ImGui::IsKeyPressed( GLFW_KEY_O )) {
             // Open session
-            std::thread (SessionFileDialogOpen, Settings::application.recentSessions.path).detach();
+            LaunchSessionFileDialogOpen(false);
             navigator.hidePannel();
         }
         else if (ImGui::IsKeyPressed( GLFW_KEY_S )) {
             // Save Session
             if (Mixer::manager().session()->filename().empty())
-                std::thread (SessionFileDialogSave, Settings::application.recentSessions.path).detach();
+                LaunchSessionFileDialogSave();
             else
                 Mixer::manager().save();
         }
@@ -266,7 +289,10 @@ void UserInterface::handleKeyboard()
         else if ( !ImGui::IsAnyWindowFocused() ){
             // Backspace to delete source
             if (ImGui::IsKeyPressed( GLFW_KEY_BACKSPACE ))
-                Mixer::manager().deleteCurrentSource();
+                Mixer::manager().post( []() {
+                    if (Mixer::manager().currentSource() != nullptr)
+                        Mixer::manager().deleteCurrentSource();
+                });
             // button under esc to toggle menu
             else if (ImGui::IsKeyPressed( GLFW_KEY_GRAVE_ACCENT ))
                 navigator.toggleMenu();
@@ -290,6 +316,8 @@ void UserInterface::handleMouse()
     mouseclic[ImGuiMouseButton_Right] = glm::vec2(io.MouseClickedPos[ImGuiMouseButton_Right].x * io.DisplayFramebufferScale.y, io.MouseClickedPos[ImGuiMouseButton_Right].y* io.DisplayFramebufferScale.x);
 
     static std::pair<Node *, glm::vec2> pick = { nullptr, glm::vec2(0.f) };
+    // cursor given by the last grab of a source
+    static int grab_cursor = ImGuiMouseCursor_Arrow;
 
     // if not on any window
     if ( !ImGui::IsAnyWindowHovered() && !ImGui::IsAnyWindowFocused() )
@@ -334,9 +362,15 @@ void UserInterface::handleMouse()
             Source *current = Mixer::manager().currentSource();
             if (current)
             {
-                // drag current source
-                int c = Mixer::manager().currentView()->grab( mouseclic[ImGuiMouseButton_Left], mousepos, current, pick);
-                ImGui::SetMouseCursor(c);
+                // drag current source (between frames, unless deleted)
+                View *view = Mixer::manager().currentView();
+                glm::vec2 from = mouseclic[ImGuiMouseButton_Left];
+                std::pair<Node *, glm::vec2> p = pick;
+                Mixer::manager().post( [view, from, mousepos, current, p]() {
+                    if (Mixer::manager().session()->find(current) != Mixer::manager().session()->end())
+                        grab_cursor = view->grab( from, mousepos, current, p);
+                });
+                ImGui::SetMouseCursor(grab_cursor);
             }
             else {
 //                Log::Info("Mouse drag (%.1f,%.1f)(%.1f,%.1f)", io.MouseClickedPos[0].x, io.MouseClickedPos[0].y, io.MousePos.x, io.MousePos.y);
@@ -350,20 +384,19 @@ void UserInterface::handleMouse()
 
             }
         }
-        else if ( ImGui::IsMouseDown(ImGuiMouseButton_Left) ) {
+        else if ( ImGui::IsMouseClicked(ImGuiMouseButton_Left) ) {
 
             // get coordinate in world coordinate of mouse cursor
             glm::vec3 point = Rendering::manager().unProject(mousepos);
 
-            // picking visitor traverses the scene
-            PickingVisitor pv(point);
-            Mixer::manager().currentView()->scene.accept(pv);
+            // pick nodes of the view under the cursor (only when button is pressed)
+            std::vector< std::pair<Node *, glm::vec2> > picked = Mixer::manager().currentView()->pick( glm::vec2(point) );
 
-            // picking visitor found nodes?
-            if (pv.picked().empty())
+            // found nodes?
+            if (picked.empty())
                 Mixer::manager().unsetCurrentSource();
             else {
-                pick = pv.picked().back();
+                pick = picked.back();
                 Mixer::manager().setCurrentSource( pick.first );
             }
 
@@ -390,31 +423,18 @@ void UserInterface::NewFrame()
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    // keep time of last input (for idle)
+    ImGuiIO& io = ImGui::GetIO();
+    bool input = io.MouseDelta.x != 0.f || io.MouseDelta.y != 0.f || io.MouseWheel != 0.f || ImGui::IsAnyMouseDown();
+    for (int k = 0; !input && k < IM_ARRAYSIZE(io.KeysDown); ++k)
+        input = io.KeysDown[k];
+    if (input)
+        last_input_ = std::chrono::steady_clock::now();
+
     // deal with keyboard and mouse events
     handleKeyboard();
     handleMouse();
 
-    // handle FileDialog
-    if (sessionFileDialogLoadFinished_) {
-        sessionFileDialogLoadFinished_ = false;
-        if (!sessionFileDialogFilename_.empty()) {
-            if (sessionFileDialogImport_)
-                Mixer::manager().import(sessionFileDialogFilename_);
-            else
-                Mixer::manager().open(sessionFileDialogFilename_);
-            Settings::application.recentSessions.path = SystemToolkit::path_filename(sessionFileDialogFilename_);
-        }
-        fileDialogPending_ = false;
-    }
-    if (sessionFileDialogSaveFinished_) {
-        sessionFileDialogSaveFinished_ = false;
-        if (!sessionFileDialogFilename_.empty()) {
-            Mixer::manager().saveas(sessionFileDialogFilename_);
-            Settings::application.recentSessions.path = SystemToolkit::path_filename(sessionFileDialogFilename_);
-        }
-        fileDialogPending_ = false;
-    }
-
     // overlay to ensure file dialog is modal
     if (fileDialogPending_){
         ImGui::OpenPopup("Busy");
@@ -503,25 +523,23 @@ void UserInterface::showMenuFile()
 
     if (ImGui::MenuItem( ICON_FA_FILE_UPLOAD "  Open", "Ctrl+O")) {
         // launch file dialog to open a session file
-        sessionFileDialogImport_ = false;
-        std::thread (SessionFileDialogOpen, Settings::application.recentSessions.path).detach();
+        LaunchSessionFileDialogOpen(false);
         navigator.hidePannel();
     }
     if (ImGui::MenuItem( ICON_FA_FILE_EXPORT " Import")) {
-        // launch file dialog to open a session file
-        sessionFileDialogImport_ = true;
-        std::thread (SessionFileDialogOpen, Settings::application.recentSessions.path).detach();
+        // launch file dialog to import a session file
+        LaunchSessionFileDialogOpen(true);
         navigator.hidePannel();
     }
     if (ImGui::MenuItem( ICON_FA_FILE_DOWNLOAD "  Save", "Ctrl+S")) {
         if (Mixer::manager().session()->filename().empty())
-            std::thread (SessionFileDialogSave, Settings::application.recentSessions.path).detach();
+            LaunchSessionFileDialogSave();
         else
             Mixer::manager().save();
         navigator.hidePannel();
     }
     if (ImGui::MenuItem( ICON_FA_SAVE "  Save as")) {
-        std::thread (SessionFileDialogSave, Settings::application.recentSessions.path).detach();
+        LaunchSessionFileDialogSave();
         navigator.hidePannel();
     }
 
@@ -565,6 +583,35 @@ void ToolBox::Render()
         {
             if ( ImGui::MenuItem( ICON_FA_CAMERA_RETRO "  Screenshot", NULL) )
                 StartScreenshot();
+            ImGui::MenuItem( "Screenshot of output", NULL, &Settings::application.screenshot_output);
+
+            if ( ImGui::MenuItem( ICON_FA_DESKTOP "  New output window", NULL) )
+                Rendering::manager().AddOutputWindow();
+
+            // record output of session
+            if (Mixer::manager().recorder() == nullptr) {
+                if ( ImGui::MenuItem( ICON_FA_CIRCLE "  Record", NULL) )
+                    Mixer::manager().startRecording();
+            }
+            else if ( ImGui::MenuItem( ICON_FA_STOP "  Stop recording", NULL) )
+                Mixer::manager().stopRecording();
+            ImGui::Combo("Codec", &Settings::application.record.profile, Recorder::profile_name,
+                         IM_ARRAYSIZE(Recorder::profile_name));
+
+            // share output of session in shared memory
+            if (Mixer::manager().sharedOutput() == nullptr) {
+                if ( ImGui::MenuItem( ICON_FA_SHARE_SQUARE "  Share output", NULL) )
+                    Mixer::manager().startSharing();
+            }
+            else if ( ImGui::MenuItem( ICON_FA_STOP "  Stop sharing", NULL) )
+                Mixer::manager().stopSharing();
+            ImGui::Combo("Format", &Settings::application.shm.format, SharedMemoryOutput::format_name,
+                         IM_ARRAYSIZE(SharedMemoryOutput::format_name));
+            const char *resolutions[5] = { "Output", FrameBuffer::resolution_name[0], FrameBuffer::resolution_name[1],
+                                           FrameBuffer::resolution_name[2], FrameBuffer::resolution_name[3] };
+            int resolution = Settings::application.shm.resolution + 1;
+            if ( ImGui::Combo("Resolution", &resolution, resolutions, IM_ARRAYSIZE(resolutions)) )
+                Settings::application.shm.resolution = resolution - 1;
 
             ImGui::MenuItem("Dev", NULL, false, false);
             ImGui::MenuItem("Icons", NULL, &show_icons_window);
@@ -575,6 +622,85 @@ void ToolBox::Render()
         ImGui::EndMenuBar();
     }
 
+    // timing of the update of session and views
+    ImGui::Text("Update %.2f ms (%d sources)", Mixer::manager().updateDuration(),
+                Mixer::manager().session()->numSource());
+
+    // number of threads for parallel update, to measure scaling
+    int threads = TaskScheduler::manager().concurrency();
+    if (ImGui::SliderInt("Threads", &threads, 1, TaskScheduler::manager().maxConcurrency())) {
+        TaskScheduler::manager().setConcurrency(threads);
+        Settings::application.threads = threads;
+    }
+
+    // pacing of output frames and of the user interface
+    ImGui::SliderInt("Output rate", &Settings::application.output_fps, 0, 120,
+                     Settings::application.output_fps > 0 ? "%d fps" : "vsync");
+    ImGui::SliderInt("Interface rate", &Settings::application.interface_fps, 0, 120,
+                     Settings::application.interface_fps > 0 ? "%d fps" : "unlimited");
+    FramePacer &pacer = FramePacer::manager();
+    ImGui::Text("Output %.1f fps, %d missed, %d UI skipped", pacer.outputRate(),
+                pacer.missedDeadlines(), pacer.skippedInterface());
+    ImGui::Checkbox("Idle when nothing changes", &Settings::application.idle);
+    ImGui::Text("%s CPU %.0f %%, %.1f draws/s", pacer.idle() ? "Idle" : "Active",
+                pacer.cpuUsage(), pacer.drawRate());
+    float mean = 0.f, deviation = 0.f, maximum = 0.f;
+    pacer.outputFrameTime(mean, deviation, maximum);
+    ImGui::Text("Frame time %.2f ms, deviation %.2f ms, max %.1f ms", mean, deviation, maximum);
+    if (pacer.missedDeadlines() > 0)
+        ImGui::Text("  last missed by %s", pacer.lastCause().c_str());
+
+    // multisampling of the output frame
+    static const char* samples_name[4] = { "None", "2x", "4x", "8x" };
+    int samples = 0;
+    while ( samples < 3 && (2 << samples) <= Settings::application.render_samples )
+        samples++;
+    if (ImGui::Combo("Antialiasing", &samples, samples_name, IM_ARRAYSIZE(samples_name)))
+        Settings::application.render_samples = samples > 0 ? 1 << samples : 0;
+
+    // GPU memory budget, to evict render targets of inactive sources
+    ImGui::SliderInt("GPU budget", &Settings::application.gpu_budget, 0, 8192,
+                     Settings::application.gpu_budget > 0 ? "%d MB" : "unlimited");
+
+    // frames recorded, waiting for the encoder and dropped
+    Recorder *recorder = Mixer::manager().recorder();
+    if (recorder)
+        ImGui::Text(ICON_FA_CIRCLE " %.1f s  %d frames (%d queued, %d dropped)", recorder->duration(),
+                    recorder->frames(), recorder->queued(), recorder->dropped());
+
+    // frames shared, with latency from rendering to shared memory
+    SharedMemoryOutput *shared = Mixer::manager().sharedOutput();
+    if (shared)
+        ImGui::Text(ICON_FA_SHARE_SQUARE " %s  %d frames (%d dropped, %.1f ms)", shared->socketPath().c_str(),
+                    shared->frames(), shared->dropped(), shared->latency());
+
+    // output windows: monitor, swap interval and time to blit and swap
+    std::vector<OutputWindow *> outputs = Rendering::manager().OutputWindows();
+    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+        OutputWindow *output = *it;
+        ImGui::PushID(output->index());
+        ImGui::Text(ICON_FA_DESKTOP " Output %d  %d frames (%.1f ms)", output->index(),
+                    output->frames(), output->swapDuration());
+        int count = 0;
+        glfwGetMonitors(&count);
+        int monitor = Settings::application.windows[output->index()].fullscreen ?
+                    Settings::application.windows[output->index()].monitor + 1 : 0;
+        if ( ImGui::SliderInt("Monitor", &monitor, 0, count, monitor > 0 ? "Fullscreen %d" : "Window") )
+            output->setMonitor(monitor - 1);
+        int interval = Settings::application.windows[output->index()].swap_interval;
+        if ( ImGui::SliderInt("Swap interval", &interval, 0, 2) )
+            output->setSwapInterval(interval);
+        if ( ImGui::Button( ICON_FA_TIMES " Close") )
+            Rendering::manager().RemoveOutputWindow(output);
+        ImGui::PopID();
+    }
+
+    // timing of the last background tasks
+    ImGui::Text("Tasks (%d pending)", TaskScheduler::manager().pendingTasks());
+    std::list<TaskScheduler::TaskTiming> timings = TaskScheduler::manager().timings();
+    for (auto t = timings.begin(); t != timings.end(); t++)
+        ImGui::Text("  %.1f ms  %s", t->duration, t->name.c_str());
+
     ImGui::End(); // "v-mix"
 
 
@@ -595,15 +721,18 @@ void ToolBox::Render()
                 screenshot_step = 2;
             break;
             case 2:
-                Rendering::manager().RequestScreenshot();
+                Rendering::manager().RequestScreenshot( Settings::application.screenshot_output ?
+                                                        Mixer::manager().session()->frame() : nullptr );
                 screenshot_step = 3;
             break;
             case 3:
             {
+                // wait for the capture to be read
+                if ( Rendering::manager().CurrentScreenshot()->IsPending() )
+                    break;
                 if ( Rendering::manager().CurrentScreenshot()->IsFull() ){
                     std::string filename =  SystemToolkit::date_time_string() + "_vmixcapture.png";
                     Rendering::manager().CurrentScreenshot()->SaveFile( filename.c_str() );
-                    Rendering::manager().CurrentScreenshot()->Clear();
                 }
                 screenshot_step = 4;
             }
@@ -1063,7 +1192,11 @@ void Navigator::RenderSourcePannel(Source *s)
         sprintf ( buf5, "%s", s->name().c_str() );
         ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
         if (ImGui::InputText("Name", buf5, 64, ImGuiInputTextFlags_CharsNoBlank)){
-            Mixer::manager().renameSource(s, buf5);
+            std::string name(buf5);
+            Mixer::manager().post( [s, name]() {
+                if (Mixer::manager().session()->find(s) != Mixer::manager().session()->end())
+                    Mixer::manager().renameSource(s, name);
+            });
         }
         // Source pannel
         static ImGuiVisitor v;
@@ -1074,9 +1207,13 @@ void Navigator::RenderSourcePannel(Source *s)
         ImGui::Text(" ");
         // Action on source
         if ( ImGui::Button("Clone", ImVec2(ImGui::GetContentRegionAvail().x, 0)) )
-            Mixer::manager().cloneCurrentSource();
+            Mixer::manager().post( []() { Mixer::manager().cloneCurrentSource(); } );
         if ( ImGui::Button("Delete", ImVec2(ImGui::GetContentRegionAvail().x, 0)) ) {
-            Mixer::manager().deleteSource(s);
+            Mixer::manager().post( [s]() {
+                // unless already deleted
+                if (Mixer::manager().session()->find(s) != Mixer::manager().session()->end())
+                    Mixer::manager().deleteSource(s);
+            });
         }
     }
     ImGui::End();
@@ -1151,7 +1288,20 @@ void Navigator::RenderNewPannel()
             if ( ImGui::Button( ICON_FA_FILE_IMPORT " Open", ImVec2(ImGui::GetContentRegionAvail().x IMGUI_RIGHT_ALIGN, 0)) ) {
                 // clear string before selection
                 file_selected = false;
-                std::thread (ImportFileDialogOpen, new_source_filename_, &file_selected, Settings::application.recentImport.path).detach();
+                if (!fileDialogPending_) {
+                    fileDialogPending_ = true;
+                    std::string path = Settings::application.recentImport.path;
+                    TaskScheduler::manager().async<std::string>("Import dialog",
+                        [path]() { return ImportFileDialogOpen(path); },
+                        [this](std::shared_future<std::string> selected) {
+                            std::string filename = selected.get();
+                            if (!filename.empty()) {
+                                snprintf(new_source_filename_, sizeof(new_source_filename_), "%s", filename.c_str());
+                                file_selected = true;
+                            }
+                            fileDialogPending_ = false;
+                        });
+                }
             }
             if ( file_selected ) {
                 file_selected = false;
@@ -1181,7 +1331,8 @@ void Navigator::RenderNewPannel()
                 new_source_preview_.draw(ImGui::GetContentRegionAvail().x IMGUI_RIGHT_ALIGN);
                 // or press Validate button
                 if ( ImGui::Button("Import", ImVec2(pannel_width - padding_width, 0)) ) {
-                    Mixer::manager().insertSource(new_source_preview_.getSource());
+                    Source *s = new_source_preview_.getSource();
+                    Mixer::manager().post( [s]() { Mixer::manager().insertSource(s); } );
                     selected_button[NAV_NEW] = false;
                 }
             }
@@ -1217,7 +1368,8 @@ void Navigator::RenderNewPannel()
                 new_source_preview_.draw(ImGui::GetContentRegionAvail().x IMGUI_RIGHT_ALIGN);
                 // ask to import the source in the mixer
                 if ( ImGui::Button("Import", ImVec2(pannel_width - padding_width, 0)) ) {
-                    Mixer::manager().insertSource(new_source_preview_.getSource());
+                    Source *s = new_source_preview_.getSource();
+                    Mixer::manager().post( [s]() { Mixer::manager().insertSource(s); } );
                     // reset for next time
                     selected_button[NAV_NEW] = false;
                 }
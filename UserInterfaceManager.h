@@ -3,6 +3,7 @@
 
 #include <string>
 #include <list>
+#include <chrono>
 using namespace std;
 
 #define NAV_COUNT 67
@@ -84,6 +85,7 @@ class UserInterface
     ToolBox toolbox;
 
     bool keyboard_modifier_active;
+    std::chrono::steady_clock::time_point last_input_;
     bool show_about;
     bool show_imgui_about;
     bool show_gst_about;
@@ -124,6 +126,8 @@ public:
 
     // status querries
     inline bool keyboardModifier() { return keyboard_modifier_active; }
+    // time of last input of user (mouse or keyboard)
+    inline std::chrono::steady_clock::time_point lastInput() const { return last_input_; }
 
 
     // TODO implement the shader editor
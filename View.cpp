@@ -6,6 +6,7 @@
 
 // memmove
 #include <string.h>
+#include <algorithm>
 
 #include "defines.h"
 #include "Settings.h"
@@ -18,6 +19,7 @@
 #include "FrameBuffer.h"
 #include "UserInterfaceManager.h"
 #include "Log.h"
+#include "GlState.h"
 
 #define CIRCLE_PIXELS 64
 #define CIRCLE_PIXEL_RADIUS 1024.0
@@ -46,6 +48,143 @@ void View::draw()
     scene.root()->draw(glm::identity<glm::mat4>(), Rendering::manager().Projection());
 }
 
+// conservative bounding box in world coordinates of a node of the workspace
+static GlmToolkit::AxisAlignedBoundingBox workspaceBox(Node *n)
+{
+    // nodes are drawn in the unit square [-1 1] of their children
+    GlmToolkit::AxisAlignedBoundingBox unit;
+    unit.extend( glm::vec3(-1.f, -1.f, 0.f) );
+    unit.extend( glm::vec3( 1.f,  1.f, 0.f) );
+
+    GlmToolkit::AxisAlignedBoundingBox box;
+    Group *g = dynamic_cast<Group *>(n);
+    if (g) {
+        for (NodeSet::iterator c = g->begin(); c != g->end(); c++)
+            box.extend( unit.transformed( (*c)->transform_ ) );
+    }
+    if (box.isNull())
+        box = unit;
+
+    // margin for the handles drawn around the nodes
+    glm::vec3 c = box.center();
+    glm::vec3 h = (box.max() - c) * 1.1f;
+    GlmToolkit::AxisAlignedBoundingBox large;
+    large.extend( c - h );
+    large.extend( c + h );
+    box = large.transformed( n->world() );
+
+    // margin for the rotation handle, which is not scaled
+    box.extend( box.min() - glm::vec3(0.1f, 0.1f, 0.f) );
+    box.extend( box.max() + glm::vec3(0.1f, 0.1f, 0.f) );
+
+    return box;
+}
+
+// latest version of the world matrix of the node and of its children
+static uint workspaceVersion(Node *n)
+{
+    uint v = n->worldVersion();
+    Group *g = dynamic_cast<Group *>(n);
+    if (g) {
+        for (NodeSet::iterator c = g->begin(); c != g->end(); c++)
+            v = MAXI(v, (*c)->worldVersion());
+    }
+    return v;
+}
+
+void View::updateWorkspaceIndex()
+{
+    // rebuild the hierarchy if nodes in the workspace changed
+    bool changed = workspace_nodes_.size() != scene.ws()->numChildren();
+    if (!changed) {
+        size_t i = 0;
+        for (NodeSet::iterator n = scene.ws()->begin(); n != scene.ws()->end(); n++, i++) {
+            if ( workspace_nodes_[i].first != (*n) || workspace_nodes_[i].second != (*n)->id() ) {
+                changed = true;
+                break;
+            }
+        }
+    }
+
+    if (changed) {
+        workspace_nodes_.clear();
+        workspace_versions_.clear();
+        std::vector<GlmToolkit::AxisAlignedBoundingBox> boxes;
+        for (NodeSet::iterator n = scene.ws()->begin(); n != scene.ws()->end(); n++) {
+            workspace_nodes_.push_back( std::pair<Node *, int>(*n, (*n)->id()) );
+            workspace_versions_.push_back( workspaceVersion(*n) );
+            boxes.push_back( workspaceBox(*n) );
+        }
+        workspace_index_.build(boxes);
+    }
+    // otherwise only update the boxes of nodes which moved
+    else {
+        bool moved = false;
+        for (size_t i = 0; i < workspace_nodes_.size(); ++i) {
+            uint v = workspaceVersion(workspace_nodes_[i].first);
+            if ( v != workspace_versions_[i] ) {
+                workspace_versions_[i] = v;
+                workspace_index_.update(i, workspaceBox(workspace_nodes_[i].first));
+                moved = true;
+            }
+        }
+        if (moved)
+            workspace_index_.refit();
+    }
+}
+
+std::vector< std::pair<Node *, glm::vec2> > View::pick(glm::vec2 point)
+{
+    PickingVisitor pv(point);
+
+    Group *root = scene.root();
+    if (!root->visible_)
+        return pv.picked();
+
+    // background and foreground are few nodes: visit them all
+    // workspace: visit only nodes with a bounding box containing the point
+    updateWorkspaceIndex();
+    std::vector<int> candidates = workspace_index_.query( glm::vec3(point, 0.f) );
+    // always visit the current source: its handles are drawn at a constant
+    // size on screen, and can be outside of its box when zoomed out
+    Source *current = Mixer::manager().currentSource();
+    if (current) {
+        for (size_t i = 0; i < workspace_nodes_.size(); ++i) {
+            if ( workspace_nodes_[i].first == current->groupNode(mode_) ) {
+                candidates.push_back( (int) i );
+                break;
+            }
+        }
+    }
+    // keep the order of nodes in workspace (from furthest to closest)
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase( std::unique(candidates.begin(), candidates.end()), candidates.end() );
+
+    if (scene.bg()->visible_) {
+        pv.setModelview(root->transform_, root->inverseTransform());
+        scene.bg()->accept(pv);
+    }
+
+    if (scene.ws()->visible_) {
+        glm::mat4 mv  = root->transform_ * scene.ws()->transform_;
+        glm::mat4 mvi = scene.ws()->inverseTransform() * root->inverseTransform();
+        for (auto c = candidates.begin(); c != candidates.end(); c++) {
+            Node *n = workspace_nodes_[*c].first;
+            if (n->visible_) {
+                pv.setModelview(mv, mvi);
+                n->accept(pv);
+            }
+        }
+    }
+
+    if (scene.fg()->visible_) {
+        pv.setModelview(root->transform_, root->inverseTransform());
+        scene.fg()->accept(pv);
+    }
+
+    return pv.picked();
+}
+
 void View::update(float dt)
 {
     // recursive update from root of scene
@@ -142,7 +281,7 @@ uint MixingView::textureMixingQuadratic()
     if (texid == 0) {
         // generate the texture with alpha exactly as computed for sources
         glGenTextures(1, &texid);
-        glBindTexture(GL_TEXTURE_2D, texid);
+        GlState::bindTexture(0, texid);
         GLubyte matrix[CIRCLE_PIXELS*CIRCLE_PIXELS * 4];
         GLubyte color[4] = {0,0,0,0};
         GLfloat luminance = 1.f;
@@ -202,16 +341,23 @@ void RenderView::setResolution(glm::vec3 resolution)
     if (resolution.x < 128.f || resolution.y < 128.f)
         resolution = FrameBuffer::getResolutionFromParameters(Settings::application.framebuffer_ar, Settings::application.framebuffer_h);
 
-    if (frame_buffer_)
+    // keep the frame buffer if resolution does not change
+    if (frame_buffer_) {
+        if ( frame_buffer_->width() == (uint) resolution.x && frame_buffer_->height() == (uint) resolution.y )
+            return;
         delete frame_buffer_;
+    }
 
     frame_buffer_ = new FrameBuffer(resolution);
+    // session frame is also drawn at reduced size (sources, previews)
+    frame_buffer_->setMipmap(true);
 }
 
 void RenderView::draw()
 {
     static glm::mat4 projection = glm::ortho(-1.f, 1.f, 1.f, -1.f, -SCENE_DEPTH, 1.f);
     glm::mat4 P  = glm::scale( projection, glm::vec3(1.f / frame_buffer_->aspectRatio(), 1.f, 1.f));
+    frame_buffer_->setSamples( (uint) MAXI(Settings::application.render_samples, 0) );
     frame_buffer_->begin();
     scene.root()->draw(glm::identity<glm::mat4>(), P);
     frame_buffer_->end();
@@ -1,6 +1,8 @@
 #ifndef VIEW_H
 #define VIEW_H
 
+#include <vector>
+#include <utility>
 #include <glm/glm.hpp>
 
 #include "Scene.h"
@@ -42,6 +44,9 @@ public:
     virtual void restoreSettings();
     virtual void saveSettings();
 
+    // get the nodes of the scene under the point (in world coordinates)
+    std::vector< std::pair<Node *, glm::vec2> > pick(glm::vec2 point);
+
     Scene scene;
 
     // hack to avoid reordering scene of view if not necessary
@@ -49,6 +54,12 @@ public:
 
 protected:
     Mode mode_;
+
+    // spatial index of the nodes in the workspace of the scene
+    GlmToolkit::BoundingVolumeHierarchy workspace_index_;
+    std::vector< std::pair<Node *, int> > workspace_nodes_;
+    std::vector< uint > workspace_versions_;
+    void updateWorkspaceIndex();
 };
 
 
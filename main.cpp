@@ -1,6 +1,10 @@
 
 #include <stdio.h>
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <cstdlib>
 
 // standalone image loader
 #include "stb_image.h"
@@ -24,10 +28,20 @@
 #include "ImGuiVisitor.h"
 
 // vmix
+#include "Log.h"
 #include "Settings.h"
 #include "Mixer.h"
 #include "RenderingManager.h"
 #include "UserInterfaceManager.h"
+#include "TaskScheduler.h"
+#include "Shader.h"
+#include "Session.h"
+#include "FrameBuffer.h"
+#include "MediaPlayer.h"
+#include "MediaSource.h"
+#include "SessionSource.h"
+#include "Exporter.h"
+#include "FramePacer.h"
 
 
 void drawScene()
@@ -35,15 +49,187 @@ void drawScene()
     Mixer::manager().draw();
 }
 
+void setupGStreamerDebug()
+{
+#ifndef NDEBUG
+    gst_debug_set_default_threshold (GST_LEVEL_WARNING);
+    gst_debug_set_active(TRUE);
+#else
+    gst_debug_set_default_threshold (GST_LEVEL_ERROR);
+    gst_debug_set_active(FALSE);
+#endif
+}
+
+static volatile std::sig_atomic_t interrupted = 0;
 
+void interrupt(int)
+{
+    interrupted = 1;
+}
+
+// true when all media of the session (and of its sub-sessions)
+// are opened or failed
+static bool mediaReady(Session *session)
+{
+    for (auto it = session->begin(); it != session->end(); it++) {
+        MediaSource *ms = dynamic_cast<MediaSource *>(*it);
+        if ( ms && !ms->mediaplayer()->isOpen() && !ms->mediaplayer()->failed() )
+            return false;
+        SessionSource *ss = dynamic_cast<SessionSource *>(*it);
+        if ( ss && !mediaReady(ss->session()) )
+            return false;
+    }
+    return true;
+}
 
-int main(int, char**)
+///
+/// Headless mode: the session is rendered in its frame buffer only,
+/// without window nor user interface. The clock is fixed if fps is given
+/// (as fast as possible), free running otherwise (real time).
+/// If an export file is given, media are decoded frame by frame at the
+/// fixed clock and every frame of the session is encoded in the file.
+///
+int headless(const std::string& filename, float fps, int frames, const std::string& exportfile)
 {
+    Log::SetConsole(true);
+
+    if ( !Rendering::manager().InitHeadless() )
+        return 1;
+
+    ShadingProgram::prewarm();
+
+    setupGStreamerDebug();
+
+    // stop on Ctrl-C
+    std::signal(SIGINT, interrupt);
+    std::signal(SIGTERM, interrupt);
+
+    // load the session and wait for its sources
+    if ( !filename.empty() ) {
+        Mixer::manager().open(filename);
+        do {
+            TaskScheduler::manager().dispatch();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } while ( TaskScheduler::manager().pendingTasks() > 0 && !interrupted );
+
+        // use the session loaded (and its resolution) from the first frame
+        Mixer::manager().apply();
+
+        // media are discovered in the background: wait until all are opened
+        // so that the first frames do not depend on timing
+        while ( !mediaReady(Mixer::manager().session()) && !interrupted )
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // frame accurate export: offline media players at fixed clock
+    Exporter *exporter = nullptr;
+    if ( !exportfile.empty() ) {
+        if (fps <= 0.f)
+            fps = 25.f;
+        FrameBuffer *output = Mixer::manager().session()->frame();
+        exporter = new Exporter(exportfile, output->width(), output->height(), fps);
+        if (exporter->failed())
+            interrupted = 1;
+        MediaPlayer::setOfflineTimeStep(1.f / fps);
+    }
+
+    float dt = fps > 0.f ? 1.f / fps : -1.f;
+    int count = 0;
+    auto start = std::chrono::steady_clock::now();
+    while ( Rendering::manager().isActive() )
+    {
+        // results of finished tasks
+        TaskScheduler::manager().dispatch();
+
+        Mixer::manager().update(dt);
+
+        Rendering::manager().Draw();
+
+        if ( exporter && !exporter->addFrame(Mixer::manager().session()->frame()) )
+            interrupted = 1;
+
+        ++count;
+        if ( interrupted || (frames > 0 && count >= frames) )
+            Rendering::manager().Close();
+    }
+    glFinish();
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    Log::Info("Rendered %d frames in %.0f ms (%.1f ms per frame).", count, elapsed, count > 0 ? elapsed / count : 0.0);
+
+    if (exporter) {
+        MediaPlayer::setOfflineTimeStep(0.f);
+        exporter->close();
+        delete exporter;
+    }
+
+    Rendering::manager().Terminate();
+
+    return 0;
+}
+
+void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [--headless] [--fps N] [--frames N] [--export file] [session.vmx]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    auto start = std::chrono::steady_clock::now();
+
+    ///
+    /// Arguments: vmix [--headless [--fps N] [--frames N] [--export file]] [session.vmx]
+    ///
+    bool headless_mode = false;
+    float fps = 0.f;
+    int frames = 0;
+    std::string filename;
+    std::string exportfile;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--headless")
+            headless_mode = true;
+        else if (arg == "--fps" && i + 1 < argc)
+            fps = atof(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (arg == "--export" && i + 1 < argc) {
+            // export is always headless
+            exportfile = argv[++i];
+            headless_mode = true;
+        }
+        else if (arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (arg.compare(0, 1, "-") == 0) {
+            // unknown option, or option without its value
+            std::cerr << "Invalid option '" << arg << "'." << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+        else if (!filename.empty()) {
+            std::cerr << "Only one session file can be given." << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            filename = arg;
+    }
+
     ///
     /// Settings
     ///
     Settings::Load();
 
+    ///
+    /// Threads for parallel update
+    ///
+    TaskScheduler::manager().setConcurrency(Settings::application.threads);
+
+    if (headless_mode)
+        return headless(filename, fps, frames, exportfile);
+
     ///
     /// RENDERING INIT
     ///
@@ -56,20 +242,23 @@ int main(int, char**)
     if ( !UserInterface::manager().Init() )
         return 1;
 
+    ///
+    /// Shaders compiled (or loaded from cache) before the first frame
+    ///
+    ShadingProgram::prewarm();
+
     ///
     /// GStreamer
     ///
-#ifndef NDEBUG
-    gst_debug_set_default_threshold (GST_LEVEL_WARNING);
-    gst_debug_set_active(TRUE);
-#else
-    gst_debug_set_default_threshold (GST_LEVEL_ERROR);
-    gst_debug_set_active(FALSE);
-#endif
+    setupGStreamerDebug();
 
 //     test text editor
 //    UserInterface::manager().fillShaderEditor( Resource::getText("shaders/image.fs") );
 
+    // open the session given in arguments
+    if ( !filename.empty() )
+        Mixer::manager().open(filename);
+
     // draw the scene
     Rendering::manager().PushFrontDrawCallback(drawScene);
 
@@ -78,9 +267,43 @@ int main(int, char**)
     ///
     while ( Rendering::manager().isActive() )
     {
-        Mixer::manager().update();
+        // results of finished tasks
+        FramePacer::manager().begin(FramePacer::TASKS);
+        TaskScheduler::manager().dispatch();
+        FramePacer::manager().end(FramePacer::TASKS);
 
-        Rendering::manager().Draw();
+        // session and outputs at output rate
+        if ( FramePacer::manager().due(FramePacer::OUTPUT) ) {
+            FramePacer::manager().begin(FramePacer::OUTPUT);
+            Mixer::manager().update();
+            Rendering::manager().DrawOutputs();
+            FramePacer::manager().end(FramePacer::OUTPUT);
+        }
+
+        // user interface, if not late for output
+        if ( FramePacer::manager().due(FramePacer::INTERFACE) ) {
+            FramePacer::manager().begin(FramePacer::INTERFACE);
+            Rendering::manager().Draw();
+            FramePacer::manager().end(FramePacer::INTERFACE);
+        }
+
+        FramePacer::manager().wait();
+
+        if (start != std::chrono::steady_clock::time_point()) {
+            Log::Info("First frame in %.0f ms.", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            start = std::chrono::steady_clock::time_point();
+        }
+    }
+
+    ///
+    /// Finish recording and sharing of output
+    ///
+    Mixer::manager().stopRecording();
+    Mixer::manager().stopSharing();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ( TaskScheduler::manager().pendingTasks() > 0 && std::chrono::steady_clock::now() < deadline ) {
+        TaskScheduler::manager().dispatch();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
     ///
@@ -0,0 +1,36 @@
+#version 330 core
+
+/*
+** One pass of a separable filter: 3 taps along filterStep
+** Operation is selected by a define inserted after #version:
+** BLUR (binomial 1 2 1), EROSION (min) or DILATION (max).
+** Successive passes along x and y with growing steps give
+** larger square kernels.
+*/
+
+out vec4 FragColor;
+
+// from vertex shader (interpolated)
+in vec4 vertexColor;
+in vec2 vertexUV;
+
+uniform sampler2D iChannel0;  // input channel (texture id).
+uniform vec2      filterStep; // offset between taps (in texture coordinates)
+
+void main(void)
+{
+    vec4 center = texture(iChannel0, vertexUV);
+    vec3 before = texture(iChannel0, vertexUV - filterStep).rgb;
+    vec3 after  = texture(iChannel0, vertexUV + filterStep).rgb;
+
+#if defined(EROSION)
+    vec3 result = min( center.rgb, min(before, after) );
+#elif defined(DILATION)
+    vec3 result = max( center.rgb, max(before, after) );
+#else
+    vec3 result = 0.25 * before + 0.5 * center.rgb + 0.25 * after;
+#endif
+
+    // alpha is not filtered
+    FragColor = vec4(result, center.a);
+}
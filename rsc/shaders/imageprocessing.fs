@@ -15,6 +15,17 @@
 #define LevelsControlOutputRange(color, minOutput, maxOutput)  mix(vec3(minOutput), vec3(maxOutput), color)
 #define LevelsControl(color, minInput, gamma, maxInput, minOutput, maxOutput)   LevelsControlOutputRange(LevelsControlInput(color, minInput, gamma, maxInput), minOutput, maxOutput)
 
+/*
+** Effects are enabled at compile time by defines inserted after #version
+** (see ImageProcessingShader): FILTER (id of filter), CHROMAKEY,
+** BRIGHTNESS_CONTRAST, LEVELS, INVERT, INVERT_LUMINANCE, HUESHIFT,
+** SATURATION, POSTERIZE, LUMAKEY, THRESHOLD.
+** Without any, the shader is a single texture fetch.
+*/
+#if defined(INVERT_LUMINANCE) || defined(HUESHIFT) || defined(SATURATION) || defined(POSTERIZE) || defined(LUMAKEY) || defined(THRESHOLD)
+#define HSL
+#endif
+
 #define ONETHIRD 0.333333
 #define TWOTHIRD 0.666666
 #define EPSILON  0.000001
@@ -33,19 +44,24 @@ uniform sampler2D iChannel0;  // input channel (texture id).
 //uniform vec3      iChannelResolution[1]; // replaced by textureSize(iChannel0, 0);
 uniform vec3      iResolution;           // viewport resolution (in pixels)
 
-uniform float contrast;
-uniform float brightness;
-uniform float saturation;
-uniform vec4  gamma;
-uniform vec4  levels;
-uniform float hueshift;
-uniform vec4  chromakey;
-uniform float chromadelta;
-uniform float threshold;
-uniform float lumakey;
-uniform int   nbColors;
-uniform int   invert;
-uniform int   filterid;
+// image processing parameters of the source (one slot of a shared buffer)
+// NB: must match layout of struct ImageProcessingShader::Parameters
+layout (std140) uniform ImageProcessing
+{
+    vec4  gamma;
+    vec4  levels;
+    vec4  chromakey;
+    float brightness;
+    float contrast;
+    float saturation;
+    float hueshift;
+    float threshold;
+    float lumakey;
+    float chromadelta;
+    int   nbColors;
+    int   invert;
+    int   filterid;
+};
 
 // conversion between rgb and YUV
 const mat4 RGBtoYUV = mat4(0.257,  0.439, -0.148, 0.0,
@@ -219,21 +235,23 @@ vec3 convolution(mat3 kernel, vec2 filter_step)
     return sum;
 }
 
+#ifdef FILTER
 vec3 apply_filter() {
 
     vec2 filter_step = 1.f / textureSize(iChannel0, 0);
 
-    if (filterid < 1 || filterid > 11)
-        return texture(iChannel0, vertexUV).rgb;
-    else if (filterid < 5)
-        return convolution( KERNEL[filterid], filter_step);
-    else if (filterid < 6)
-        return opening(filter_step);
-    else if (filterid < 9)
-        return erosion( filterid - 6 , filter_step);
-    else
-        return dilation( filterid - 9, filter_step);
+    // blur and the large erosion and dilation are separable (see ImageFilter)
+#if FILTER < 5
+    return convolution( KERNEL[FILTER], filter_step);
+#elif FILTER < 6
+    return opening(filter_step);
+#elif FILTER < 9
+    return erosion( FILTER - 6 , filter_step);
+#else
+    return dilation( FILTER - 9, filter_step);
+#endif
 }
+#endif
 
 /*
 ** Hue, saturation, luminance <=> Red Green Blue
@@ -313,53 +331,77 @@ float alphachromakey(vec3 color, vec3 colorKey, float delta)
 
 void main(void)
 {
+    vec4 texel = texture(iChannel0, vertexUV);
 
     // deal with alpha separately
-    float ma = texture(iChannel0, vertexUV).a;
-//    float ma = texture(maskTexture, vertexUV).a * texture(iChannel0, vertexUV).a;
-    float alpha = clamp(ma * color.a, 0.0, 1.0);
+    float alpha = clamp(texel.a * color.a, 0.0, 1.0);
 
-    // read color & apply basic filterid
-    vec3 transformedRGB;
-    transformedRGB = apply_filter();
+    // read color & apply basic filter
+#ifdef FILTER
+    vec3 transformedRGB = apply_filter();
+#else
+    vec3 transformedRGB = texel.rgb;
+#endif
 
     // chromakey
-    alpha -= mix( 0.0, 1.0 - alphachromakey( transformedRGB, chromakey.rgb, chromadelta), float(chromadelta > 0.0001) );
+#ifdef CHROMAKEY
+    alpha -= 1.0 - alphachromakey( transformedRGB, chromakey.rgb, chromadelta);
+#endif
 
     // color transformation
+#ifdef BRIGHTNESS_CONTRAST
     transformedRGB = mix(vec3(0.62), transformedRGB, contrast + 1.0) + brightness;
+#endif
+#ifdef LEVELS
     transformedRGB = LevelsControl(transformedRGB, levels.x, gamma.rgb * gamma.a, levels.y, levels.z, levels.w);
+#else
+    transformedRGB = clamp(transformedRGB, 0.0, 1.0);
+#endif
 
     // RGB invert
-    transformedRGB = vec3(float(invert==1)) + ( transformedRGB * vec3(1.0 - 2.0 * float(invert==1)) );
+#ifdef INVERT
+    transformedRGB = vec3(1.0) - transformedRGB;
+#endif
 
+#ifdef HSL
     // Convert to HSL
     vec3 transformedHSL = RGB2HSV( transformedRGB );
 
     // Luminance invert
-    transformedHSL.z = float(invert==2) +  transformedHSL.z * (1.0 - 2.0 * float(invert==2) );
+#ifdef INVERT_LUMINANCE
+    transformedHSL.z = 1.0 - transformedHSL.z;
+#endif
 
     // perform hue shift
+#ifdef HUESHIFT
     transformedHSL.x = transformedHSL.x + hueshift;
+#endif
 
     // Saturation
+#ifdef SATURATION
     transformedHSL.y *= saturation + 1.0;
+#endif
 
     // perform reduction of colors
-    transformedHSL = mix( transformedHSL, floor(transformedHSL * vec3(nbColors)) / vec3(nbColors-1),  float( nbColors > 0 ) );
+#ifdef POSTERIZE
+    transformedHSL = floor(transformedHSL * vec3(nbColors)) / vec3(nbColors-1);
+#endif
 
     // luma key
-    alpha -= mix( 0.0, step( transformedHSL.z, lumakey ), float(lumakey > EPSILON));
+#ifdef LUMAKEY
+    alpha -= step( transformedHSL.z, lumakey );
+#endif
 
     // level threshold
-    transformedHSL = mix( transformedHSL, vec3(0.0, 0.0, step( transformedHSL.z, threshold )), float(threshold > EPSILON));
+#ifdef THRESHOLD
+    transformedHSL = vec3(0.0, 0.0, step( transformedHSL.z, threshold ));
+#endif
 
     // after operations on HSL, convert back to RGB
     transformedRGB = HSV2RGB(transformedHSL);
+#endif
 
     // apply base color and alpha for final fragment color
     FragColor = vec4(transformedRGB * vertexColor.rgb * color.rgb, clamp(alpha, 0.0, 1.0) );
 
 }
-
-
@@ -0,0 +1,108 @@
+/**
+ * meshconvert : converts an ASCII PLY file into a binary mesh file
+ *
+ * Used at build time for the meshes of the resources (see MeshFile.h)
+ *
+ * Usage: meshconvert input.ply output.mesh
+ */
+
+#include <cstdio>
+#include <cstdarg>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "Log.h"
+#include "PlyParser.h"
+#include "MeshFile.h"
+
+// messages of the parser are printed on the console
+static void print(const char *level, const char* fmt, va_list args)
+{
+    fprintf(stderr, "meshconvert %s: ", level);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+}
+
+void Log::Info(const char* fmt, ...)    { va_list args; va_start(args, fmt); print("info", fmt, args); va_end(args); }
+void Log::Notify(const char* fmt, ...)  { va_list args; va_start(args, fmt); print("info", fmt, args); va_end(args); }
+void Log::Warning(const char* fmt, ...) { va_list args; va_start(args, fmt); print("warning", fmt, args); va_end(args); }
+void Log::Error(const char* fmt, ...)   { va_list args; va_start(args, fmt); print("error", fmt, args); va_end(args); }
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s input.ply output.mesh\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input) {
+        fprintf(stderr, "meshconvert: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    std::stringstream ascii;
+    ascii << input.rdbuf();
+
+    std::vector<glm::vec3> points;
+    std::vector<glm::vec4> colors;
+    std::vector<glm::vec2> texCoords;
+    std::vector<uint> indices;
+    uint drawMode = 0;
+    if ( !parsePLY(ascii.str(), points, colors, texCoords, indices, drawMode) || points.empty() ) {
+        fprintf(stderr, "meshconvert: invalid PLY file %s\n", argv[1]);
+        return 1;
+    }
+    bool uv = texCoords.size() == points.size();
+
+    MeshFileHeader header;
+    header.magic = MESHFILE_MAGIC;
+    header.version = MESHFILE_VERSION;
+    header.drawMode = drawMode;
+    header.vertexCount = points.size();
+    header.vertexStride = sizeof(glm::vec3) + sizeof(glm::vec4) + (uv ? sizeof(glm::vec2) : 0);
+    header.hasTexCoords = uv ? 1 : 0;
+    header.indexCount = indices.size();
+    header.indexSize = points.size() > 65535 ? 4 : 2;
+
+    // precomputed axis aligned bounding box
+    glm::vec3 bmin = points[0], bmax = points[0];
+    for (auto p = points.begin(); p != points.end(); p++) {
+        bmin = glm::min(bmin, *p);
+        bmax = glm::max(bmax, *p);
+    }
+    for (int c = 0; c < 3; ++c) {
+        header.bboxMin[c] = bmin[c];
+        header.bboxMax[c] = bmax[c];
+    }
+
+    std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+    output.write( (const char *) &header, sizeof(MeshFileHeader) );
+
+    // interleaved vertices
+    for (size_t v = 0; v < points.size(); ++v) {
+        output.write( (const char *) &points[v], sizeof(glm::vec3) );
+        output.write( (const char *) &colors[v], sizeof(glm::vec4) );
+        if (uv)
+            output.write( (const char *) &texCoords[v], sizeof(glm::vec2) );
+    }
+
+    // 16 or 32 bits indices
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (header.indexSize == 2) {
+            uint16_t index = indices[i];
+            output.write( (const char *) &index, sizeof(uint16_t) );
+        }
+        else {
+            uint32_t index = indices[i];
+            output.write( (const char *) &index, sizeof(uint32_t) );
+        }
+    }
+
+    if (!output) {
+        fprintf(stderr, "meshconvert: cannot write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}